@@ -13,6 +13,8 @@ fail
 gap> G:=PGL(2,5);;
 gap> GRAPE_ExactSetCover(G,[[1,2,3]],6);
 [ [ 1, 2, 3 ], [ 4, 5, 6 ] ]
+gap> GRAPE_ExactSetCover(G,[[1,2,3]],6,Group(()),"count");
+10
 gap> n:=280;;
 gap> G:=OnePrimitiveGroup(NrMovedPoints,n,Size,604800*2);
 J_2.2
@@ -118,6 +118,10 @@ gap> GeneralizedOrbitalGraphs(C,1);
   rec( adjacencies := [ [ 4 ] ], group := Group([ (1,2,3,4,5,6) ]),
       isGraph := true, isSimple := true, order := 6, representatives := [ 1 ],
       schreierVector := [ -1, 1, 1, 1, 1, 1 ] ) ]
+gap> G:=JohnsonGraph(7,3).group;;
+gap> iter:=IteratorOfGeneralizedOrbitalGraphs(G,false,x->Diameter(x)=2);;
+gap> D:=[];; for gamma in iter do Add(D,VertexDegrees(gamma)); od; Set(D);
+[ [ 16 ], [ 18 ], [ 22 ], [ 30 ] ]
 gap> gamma := NullGraph( Group( (1,3), (1,2)(3,4) ) );;
 gap> AddEdgeOrbit( gamma, [4,3] );
 gap> gamma;
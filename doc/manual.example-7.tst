@@ -8,7 +8,7 @@ rec( adjacencies := [ [ 2, 3, 4, 5, 6, 7 ] ], group := Group([ (1,5,8,10,4)
 gap> VertexColouring(J);
 [ 1, 3, 5, 4, 2, 3, 6, 1, 5, 2 ]
 gap> VertexColouring(J,5);
-[ 1, 2, 3, 4, 5, 4, 2, 1, 3, 5 ]
+[ 1, 2, 3, 4, 3, 5, 2, 4, 5, 1 ]
 gap> VertexColouring(J,4);
 fail
 gap> gamma:=JohnsonGraph(7,3);;
@@ -29,7 +29,7 @@ rec( adjacencies := [ [ 2, 3, 4, 5, 6, 7 ] ], group := Group([ (1,5,8,10,4)
   representatives := [ 1 ], schreierVector := [ -1, 2, 2, 1, 1, 1, 2, 1, 1, 1
      ] )
 gap> MinimumVertexColouring(J);
-[ 1, 2, 3, 4, 5, 4, 2, 1, 3, 5 ]
+[ 1, 2, 3, 4, 3, 5, 2, 4, 5, 1 ]
 gap> ChromaticNumber(JohnsonGraph(5,2));
 5
 gap> ChromaticNumber(JohnsonGraph(6,2));
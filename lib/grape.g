@@ -54,6 +54,62 @@ GRAPE_DREADNAUT_INPUT_USE_STRING := false;
    # Using a string is faster than using a file, but may use
    # too much storage.
 
+GRAPE_STABILIZER_CACHE_SIZE := 1000;
+   # The maximum number of point and set stabilizers cached for
+   # a permutation group by  GRAPE.  When this number is reached,
+   # the cache for that group is emptied.  If this value is 0, then
+   # no stabilizers are cached.
+
+GRAPE_CLIQUES_SMALLORDER := 8;
+   # In searches for complete subgraphs with isomorph rejection, 
+   # this rejection is performed via explicit orbits on complete 
+   # subgraphs when the group concerned has order at most this value,
+   # and via  SmallestImageSet  otherwise. 
+
+GRAPE_CHECKPOINT_FILE := fail;
+   # If this is the name of a file, then long searches for complete
+   # subgraphs and for partial linear spaces periodically save
+   # their state in this file, and a later call with the same
+   # parameters resumes the search from the state saved there.
+   # The file is removed when the search completes.
+   # The default (fail) is not to checkpoint.
+
+GRAPE_CHECKPOINT_INTERVAL := 600;
+   # The minimum (CPU) time in seconds between successive
+   # checkpoints written to  GRAPE_CHECKPOINT_FILE.
+
+GRAPE_DSATUR_NODE_LIMIT := 100000;
+   # The maximum number of search nodes used by the DSATUR backtrack
+   # search tried by  VertexColouring(<gamma>,<k>)  before it falls
+   # back on the clique covering method.  If this value is 0, then
+   # the DSATUR search is not tried.
+
+GRAPE_NUMBER_OF_JOBS := 1;
+   # If this is greater than 1 and the IO package is loaded, then
+   # the relation given to  Graph  is evaluated in parallel by this 
+   # number of forked processes.
+
+GRAPE_NAUTY_THREADS := 1;
+   # If this is greater than 1, then dreadnaut is asked to use this
+   # number of threads when only an automorphism group is computed,
+   # dividing the search at the root (canonical labellings are always
+   # computed with one thread, so that they do not depend on this
+   # value).  This only pays off when the target cell at the root has
+   # little symmetry, as for rigid strongly regular graphs; for 
+   # vertex-transitive graphs it makes the search slower.
+
+GRAPE_NAUTY_INVARIANT_BUDGET := 0;
+   # If this is positive, then for graphs without loops or directed
+   # edges, dreadnaut is asked to use its adaptive vertex-invariant 
+   # at the top two levels of the search tree. For each cell of the 
+   # refined partition this tries the invariants distances, cellquads 
+   # and cellfano2, cheapest first, skipping any estimated to take
+   # more than this many million steps, until one splits the cell.
+   # This can greatly reduce the search for strongly regular and other
+   # highly regular graphs, but costs time for other graphs.
+   # Canonical labellings computed with different values of this
+   # variable must not be compared.
+
 # The following variant of GAP's Exec is more flexible, and does not require a
 # shell. That makes it more reliable on Windows resp. with Cygwin. Moreover,
 # it allows to redirect input and output.
@@ -175,6 +231,80 @@ od;
 return newgens;
 end);
 
+DeclareAttribute("GRAPE_StabilizerCache",IsPermGroup,"mutable");
+#
+# The value of this attribute is a record storing the point stabilizers,
+# the orbit numbers of point stabilizers, and the set stabilizers of
+# the group, which have been computed by  GRAPE.  Since the group of 
+# a graph is replaced by  NewGroupGraph,  cached stabilizers for 
+# a graph are never used for a different group.
+#
+InstallMethod(GRAPE_StabilizerCache,"for a permutation group",[IsPermGroup],
+   G->rec(count:=0,points:=[],orbitNumbers:=[],
+          sets:=[],setStabilizers:=[]));
+
+BindGlobal("GRAPE_StabilizerCacheMakeRoom",function(cache)
+#
+# Empties the stabilizer cache  cache  if it is full. 
+# Returns false if no stabilizers are to be cached, else returns true.
+#
+if GRAPE_STABILIZER_CACHE_SIZE<=0 then
+   return false;
+fi;
+if cache.count>=GRAPE_STABILIZER_CACHE_SIZE then
+   cache.count:=0;
+   cache.points:=[];
+   cache.orbitNumbers:=[];
+   cache.sets:=[];
+   cache.setStabilizers:=[];
+fi;
+cache.count:=cache.count+1;
+return true;
+end);
+
+BindGlobal("GRAPE_PointStabilizer",function(G,pt)
+#
+# Returns  Stabilizer(G,pt),  using and updating the stabilizer cache 
+# of the permutation group  G.
+#
+local cache,H;
+cache:=GRAPE_StabilizerCache(G);
+if IsBound(cache.points[pt]) then
+   return cache.points[pt];
+fi;
+H:=Stabilizer(G,pt);
+if GRAPE_StabilizerCacheMakeRoom(cache) then
+   cache.points[pt]:=H;
+fi;
+return H;
+end);
+
+BindGlobal("GRAPE_SetStabilizer",function(G,set)
+#
+# Returns  Stabilizer(G,set,OnSets),  using and updating the stabilizer 
+# cache of the permutation group  G.
+#
+local cache,H,pos;
+if not IsSSortedList(set) then
+   set:=SSortedList(set);
+fi;
+cache:=GRAPE_StabilizerCache(G);
+pos:=PositionSorted(cache.sets,set);
+if pos<=Length(cache.sets) and cache.sets[pos]=set then
+   return cache.setStabilizers[pos];
+fi;
+H:=Stabilizer(G,set,OnSets);
+if GRAPE_StabilizerCacheMakeRoom(cache) then
+   if cache.count=1 then
+      # the cache has just been emptied
+      pos:=1;
+   fi;
+   Add(cache.sets,Immutable(set),pos);
+   Add(cache.setStabilizers,H,pos);
+fi;
+return H;
+end);
+
 BindGlobal("ProbablyStabilizer",function(G,pt)
 #
 # Returns a subgroup of  Stabilizer(G,pt),  which is very often 
@@ -186,7 +316,7 @@ if not IsPermGroup(G) or not IsInt(pt) then
    Error("usage: ProbablyStabilizer( <PermGroup>, <Int> )");
 fi;
 if not GRAPE_RANDOM or HasSize(G) or HasStabChainMutable(G) or IsAbelian(G) then
-   return Stabilizer(G,pt);
+   return GRAPE_PointStabilizer(G,pt);
 fi;
 #
 # At this point we know that  G  is non-abelian.  In particular,
@@ -240,11 +370,26 @@ BindGlobal("ProbablyStabilizerOrbitNumbers",function(G,pt,n)
 # This subgroup is very often the full stabilizer, and in fact, 
 # if  GRAPE_RANDOM=false,  then it is guaranteed to be the full stabilizer. 
 #
+# The returned record is immutable, and is cached (together with  n)  
+# when  GRAPE_RANDOM=false.
+#
+local cache,orbs;
 if not IsPermGroup(G) or not IsInt(pt) or not IsInt(n) then
    Error(
    "usage: ProbablyStabilizerOrbitNumbers( <PermGroup>, <Int>, <Int>  )");
 fi;
-return GRAPE_OrbitNumbers(ProbablyStabilizer(G,pt),n);
+if GRAPE_RANDOM then
+   return Immutable(GRAPE_OrbitNumbers(ProbablyStabilizer(G,pt),n));
+fi;
+cache:=GRAPE_StabilizerCache(G);
+if IsBound(cache.orbitNumbers[pt]) and cache.orbitNumbers[pt][1]=n then
+   return cache.orbitNumbers[pt][2];
+fi;
+orbs:=Immutable(GRAPE_OrbitNumbers(ProbablyStabilizer(G,pt),n));
+if GRAPE_StabilizerCacheMakeRoom(cache) then
+   cache.orbitNumbers[pt]:=[n,orbs];
+fi;
+return orbs;
 end);
 
 BindGlobal("GRAPE_RepWord",function(gens,sch,r)
@@ -371,6 +516,66 @@ od;
 return gamma;
 end);
 
+BindGlobal("GRAPE_ParList",function(list,func)
+#
+# Returns  List(list,func),  computed in parallel by  GRAPE_NUMBER_OF_JOBS 
+# forked processes if this is greater than 1 and the function 
+# ParListByFork  of the IO package is available.  The results of  func 
+# must then be objects which the IO package can pickle.
+#
+local njobs;
+njobs:=Minimum(GRAPE_NUMBER_OF_JOBS,Length(list));
+if njobs<=1 or not IsBoundGlobal("ParListByFork") then
+   return List(list,func);
+fi;
+return ValueGlobal("ParListByFork")(list,func,rec(NumberJobs:=njobs));
+end);
+
+BindGlobal("GRAPE_RelationValues",function(rel,x,Y,batch)
+#
+# Returns the list of the values  rel(x,y)  for  y  in the list  Y. 
+# If  batch=true  then, for a list  Z,  rel(x,Z)  must return this 
+# list of values for  Z  in place of  Y.  The values may be computed
+# in parallel (see  GRAPE_ParList),  and each must be  true  or  false.
+#
+local njobs,size,vals;
+if not batch then
+   vals:=GRAPE_ParList(Y,y->rel(x,y));
+else
+   njobs:=Minimum(GRAPE_NUMBER_OF_JOBS,Length(Y));
+   if njobs<=1 or not IsBoundGlobal("ParListByFork") then
+      vals:=rel(x,Y);
+   else
+      size:=QuoInt(Length(Y)+njobs-1,njobs);
+      vals:=Concatenation(GRAPE_ParList([0..QuoInt(Length(Y)-1,size)],
+         j->rel(x,Y{[j*size+1..Minimum((j+1)*size,Length(Y))]})));
+   fi;
+   if not IsList(vals) or Length(vals)<>Length(Y) then
+      Error("<rel> must return a list of the same length as its second argument");
+   fi;
+fi;
+if not (IsDenseList(vals) and ForAll(vals,v->v=true or v=false)) then
+   Error("<rel> must return true or false");
+fi;
+return vals;
+end);
+
+BindGlobal("GRAPE_ActionStabChain",function(H,G)
+#
+# Let  H  be the permutation group image of an action of the group  G.  
+# If  GRAPE_RANDOM=false  and the order of  G  is known or easily 
+# computed, then this function computes a stabilizer chain for  H,  
+# using the order of  G  as a limit on the order of  H.
+#
+if not GRAPE_RANDOM then
+   if (HasSize(G) and Size(G)<>infinity) or 
+      (IsPermGroup(G) and HasStabChainMutable(G)) or
+      (HasIsNaturalSymmetricGroup(G) and IsNaturalSymmetricGroup(G)) then
+      StabChainOp(H,rec(limit:=Size(G)));
+   fi;
+fi;
+end);
+
 BindGlobal("GRAPE_Graph",function(arg)
 #
 # First suppose that  arg[5]  is unbound or has value  false.
@@ -387,7 +592,12 @@ BindGlobal("GRAPE_Graph",function(arg)
 # the function  GRAPE_Graph  behaves as above, except that  gamma.names
 # becomes an immutable copy of  L.
 #
-local G,L,act,rel,invt,gamma,vertexnames,i,reps,H,orb,x,y,adj;
+# If the option  relbatch  is set, then  rel  is instead called as 
+# rel(x,Y)  for a list  Y  of elements of  S,  and must return the list 
+# of the values  rel(x,y)  for  y  in  Y.  The relation is evaluated 
+# in parallel when  GRAPE_NUMBER_OF_JOBS>1  (see  GRAPE_ParList).
+#
+local G,L,act,rel,invt,gamma,vertexnames,i,reps,H,orbs,x,vals,adj,batch,j;
 G:=arg[1];
 L:=arg[2];
 act:=arg[3];
@@ -409,25 +619,23 @@ fi;
 gamma:=NullGraph(Action(G,vertexnames,act),Length(vertexnames));
 Unbind(gamma.isSimple);
 gamma.names:=vertexnames;
-if not GRAPE_RANDOM then
-   if (HasSize(G) and Size(G)<>infinity) or 
-      (IsPermGroup(G) and HasStabChainMutable(G)) or
-      (HasIsNaturalSymmetricGroup(G) and IsNaturalSymmetricGroup(G)) then
-      StabChainOp(gamma.group,rec(limit:=Size(G)));
-   fi;
-fi;
+GRAPE_ActionStabChain(gamma.group,G);
+batch:=ValueOption("relbatch")=true;
 reps:=gamma.representatives;
 for i in [1..Length(reps)] do
    H:=ProbablyStabilizer(gamma.group,reps[i]);
    x:=vertexnames[reps[i]];
    if IsTrivial(H) then  
-      gamma.adjacencies[i]:=Filtered([1..gamma.order],j->rel(x,vertexnames[j]));
+      vals:=GRAPE_RelationValues(rel,x,vertexnames,batch);
+      gamma.adjacencies[i]:=Filtered([1..gamma.order],j->vals[j]=true);
    else
+      orbs:=OrbitsDomain(H,[1..gamma.order]);
+      vals:=GRAPE_RelationValues(rel,x,vertexnames{List(orbs,orb->orb[1])},
+               batch);
       adj:=[];
-      for orb in OrbitsDomain(H,[1..gamma.order]) do
-	 y:=vertexnames[orb[1]];
-	 if rel(x,y) then
-	    Append(adj,orb);
+      for j in [1..Length(orbs)] do
+	 if vals[j]=true then
+	    Append(adj,orbs[j]);
 	 fi;
       od;
       Sort(adj);
@@ -451,17 +659,64 @@ BindGlobal("JohnsonGraph",function(n,e)
 # of {1,...,n},  with x joined to y iff  Intersection(x,y)
 # has size  e-1.
 #
-local rel,J;
+# The graph is constructed directly, rather than by  Graph,  using the
+# position  rank(x)  of an e-subset  x  in  Combinations([1..n],e)
+# to determine the group and the adjacency of the first vertex. 
+#
+local rel,J,G,names,cumul,rank,gens,adj,i,j;
 if not IsInt(n) or not IsInt(e) then 
    Error("usage: JohnsonGraph( <Int>, <Int> )");
 fi;
 if e<0 or n<e then
    Error("must have 0 <= <e> <= <n>");
 fi;
-rel := function(x,y)
-   return Length(Intersection(x,y))=e-1; 
+if e=0 or e=n then
+   rel := function(x,y)
+      return Length(Intersection(x,y))=e-1; 
+   end;
+   J:=Graph(SymmetricGroup(n),Combinations([1..n],e),OnSets,rel,true);
+   J.isSimple:=true;
+   return J;
+fi;
+# cumul[i][v]  is the sum of  Binomial(n-j,e-i)  for  j  in  [1..v-1],
+# so that  rank(x)  is 1 plus the sum over  i  of the number of e-subsets 
+# agreeing with  x  in their first  i-1  elements and having i-th
+# element strictly between  x[i-1]  and  x[i].
+cumul:=List([1..e],i->[0]);
+for i in [1..e] do
+   for j in [1..n] do
+      cumul[i][j+1]:=cumul[i][j]+Binomial(n-j,e-i);
+   od;
+od;
+rank := function(x)
+   # Returns the position of the e-subset  x  in  names.
+   local r,i,prev;
+   r:=1;
+   prev:=0;
+   for i in [1..e] do
+      r:=r+cumul[i][x[i]]-cumul[i][prev+1];
+      prev:=x[i];
+   od;
+   return r;
 end;
-J:=Graph(SymmetricGroup(n),Combinations([1..n],e),OnSets,rel,true);
+G:=SymmetricGroup(n);
+names:=Immutable(Combinations([1..n],e));
+gens:=List(GeneratorsOfGroup(G),g->PermList(List(names,x->rank(OnSets(x,g)))));
+J:=NullGraph(GroupWithGenerators(gens,()),Length(names));
+Unbind(J.isSimple);
+J.names:=names;
+GRAPE_ActionStabChain(J.group,G);
+# The first vertex is  [1..e],  and its neighbours are obtained by
+# replacing an element of  [1..e]  by an element of  [e+1..n].
+adj:=[];
+for i in [1..e] do
+   for j in [e+1..n] do
+      Add(adj,rank(Concatenation([1..i-1],[i+1..e],[j])));
+   od;
+od;
+Sort(adj);
+IsSSortedList(adj);
+J.adjacencies[1]:=adj;
 J.isSimple:=true;
 return J;
 end);
@@ -475,7 +730,13 @@ BindGlobal("HammingGraph",function(d,q)
 # Hamming distance is 1. The group associated with the returned
 # graph is  S_q wr S_d  in its product action on the vertices.
 #
-local W,projection,embedding,moved,act,rel;
+# The graph is constructed directly, rather than by  Graph,  using 
+# the position  1+Sum([1..d],i->(x[i]-1)*q^(d-i))  of a d-tuple  x  
+# in  Tuples([1..q],d)  to determine the group and the adjacency of 
+# the first vertex. 
+#
+local W,projection,embedding,moved,names,powers,gens,g,bb,b,a,img,adj,i,c,
+      gamma;
 if not IsPosInt(d) or not IsPosInt(q) then 
    Error("usage: HammingGraph( <PosInt>, <PosInt> )"); 
 fi;
@@ -488,35 +749,36 @@ W:=WreathProductImprimitiveAction(SymmetricGroup([1..q]),SymmetricGroup([1..d]))
 projection:=Projection(W);
 embedding:=Embedding(W,d+1);
 moved:=List([1..d],i->MovedPoints(Image(Embedding(W,i))));
-act := function(x,g)
-# Product action of  g  on d-tuple  x.
-local bb,b,a,y,i;
-bb:=g^projection;
-b:=bb^embedding;
-a:=g*b^(-1); # so g factorises as a*b in W
-y:=[];
-for i in [1..d] do
-   y[i^bb]:=PositionSorted(moved[i],moved[i][x[i]]^a);
+names:=Immutable(Tuples([1..q],d));
+powers:=List([1..d],i->q^(d-i));
+# An element  g  of  W  factorises as  a*b,  where  b  permutes the
+# coordinates as  bb=g^projection  does, and then  g  maps the d-tuple 
+# x  to  y,  where  y[i^bb]=img[i][x[i]].
+gens:=[];
+for g in GeneratorsOfGroup(W) do
+   bb:=g^projection;
+   b:=bb^embedding;
+   a:=g*b^(-1);
+   img:=List([1..d],i->List([1..q],c->PositionSorted(moved[i],moved[i][c]^a)));
+   Add(gens,PermList(List(names,
+      x->1+Sum([1..d],i->(img[i][x[i]]-1)*powers[i^bb])))); 
 od;
-return y;
-end;
-rel := function(x,y)
-# boolean function returning true iff the d-tuples  x  and  y
-# are at Hamming distance 1. 
-local i,count;
-count:=0; 
+gamma:=NullGraph(GroupWithGenerators(gens,()),Length(names));
+Unbind(gamma.isSimple);
+gamma.names:=names;
+GRAPE_ActionStabChain(gamma.group,W);
+# The first vertex is  [1,...,1],  and its neighbours are obtained by
+# changing one coordinate.
+adj:=[];
 for i in [1..d] do
-   if x[i]<>y[i] then
-      count:=count+1;
-      if count>1 then 
-         return false;
-      fi;
-   fi;
-od; 
-return count=1;
-end;
-# Now construct and return the Hamming graph.
-return Graph(W,Tuples([1..q],d),act,rel,true);
+   for c in [2..q] do
+      Add(adj,1+(c-1)*powers[i]);
+   od;
+od;
+Sort(adj);
+IsSSortedList(adj);
+gamma.adjacencies[1]:=adj;
+return gamma;
 end); 
 
 BindGlobal("IsGraph",function(obj)
@@ -818,7 +1080,7 @@ od;
 if not(y in gamma.adjacencies[-sch[x]]) then
    #  e  is not an edge of  gamma
    if not IsBound(arg[3]) then
-      orb:=Orbit(Stabilizer(gamma.group,x),y);
+      orb:=Orbit(GRAPE_PointStabilizer(gamma.group,x),y);
    else
       if ForAny(GeneratorsOfGroup(arg[3]),x->e[1]^x<>e[1]) then
 	 Error("<arg[3]>  not equal to  Stabilizer(<gamma.group>,<e[1]>)");
@@ -881,7 +1143,7 @@ od;
 if y in gamma.adjacencies[-sch[x]] then
    #  e  is an edge of  gamma
    if not IsBound(arg[3]) then
-      orb:=Orbit(Stabilizer(gamma.group,x),y);
+      orb:=Orbit(GRAPE_PointStabilizer(gamma.group,x),y);
    else
       if ForAny(GeneratorsOfGroup(arg[3]),x->e[1]^x<>e[1]) then
 	 Error("<arg[3]>  not equal to  Stabilizer(<gamma.group>,<e[1]>)");
@@ -940,6 +1202,35 @@ od;
 return gamma;
 end);
 
+BindGlobal("GRAPE_PairedOrbitalEdges",function(G,n)
+#
+# Let  G  be a permutation group, transitive on  [1..n].  Then this 
+# function returns a list  M  whose i-th element is a list of edges 
+# such that the union of the G-orbits of the edges in  M[i]  is the 
+# union of a nondiagonal G-orbital and its paired orbital, and 
+# each such union is obtained for exactly one  i.
+#
+local H,reps,i,L,M,mm;
+H:=GRAPE_PointStabilizer(G,1);
+reps:=Set(List(OrbitsDomain(H,[2..n]),Minimum));
+#
+# Now make a duplicate-free list  L  of the graphs
+# with vertex-set  [1..n]  and edge-set the union
+# of a nondiagonal G-orbital and its paired orbital.
+# At the same time, make the list  M.
+#
+L:=[];
+M:=[];
+for i in [1..Length(reps)] do
+   if ForAll(L,x->not IsEdge(x,[1,reps[i]])) then
+      mm:=[[1,reps[i]],[reps[i],1]];
+      Add(L,EdgeOrbitsGraph(G,mm));
+      Add(M,mm);
+   fi;
+od;
+return M;
+end);
+
 BindGlobal("GeneralizedOrbitalGraphs",function(arg)
 #
 # Let  G=arg[1]. Then  G  must be a non-trivial permutation group,
@@ -962,7 +1253,7 @@ BindGlobal("GeneralizedOrbitalGraphs",function(arg)
 #
 # The group associated with each returned graph in the list is  G. 
 #
-local G,k,comb,combinations,n,H,result,reps,i,L,M,mm;
+local G,k,comb,combinations,n,result,M;
 if not (Length(arg) in [1,2]) then
    Error("must have 1 or 2 arguments");
 fi;
@@ -982,25 +1273,7 @@ fi;
 if not ((k in [false,true]) or (IsInt(k) and k>=0)) then 
    Error("<k> must be in  [false,true]  or be a non-negative integer");
 fi;
-H:=Stabilizer(G,1);
-reps:=Set(List(OrbitsDomain(H,[2..n]),Minimum));
-#
-# Now make a duplicate-free list  L  of the graphs
-# with vertex-set  [1..n]  and edge-set the union
-# of a nondiagonal G-orbital and its paired orbital.
-# At the same time, make a list  M  whose i-th element is
-# a list of edges of  L[i],  such that the union of the
-# G-orbits of the edges in  M[i]  is the edge-set of  L[i].
-#
-L:=[];
-M:=[];
-for i in [1..Length(reps)] do
-   if ForAll(L,x->not IsEdge(x,[1,reps[i]])) then
-      mm:=[[1,reps[i]],[reps[i],1]];
-      Add(L,EdgeOrbitsGraph(G,mm));
-      Add(M,mm);
-   fi;
-od;
+M:=GRAPE_PairedOrbitalEdges(G,n);
 result:=[];
 if k in [false,true] then
    combinations:=Combinations(M);
@@ -1016,6 +1289,132 @@ od;
 return result;
 end);
 
+BindGlobal("IteratorOfGeneralizedOrbitalGraphs",function(arg)
+#
+# Let  G=arg[1]  and  k=arg[2]  (default: false)  be as for 
+# GeneralizedOrbitalGraphs,  and let  filter=arg[3]  (default: 
+# ReturnTrue)  be a function taking a graph and returning  true  
+# or  false.  
+#
+# Then this function returns an iterator for the graphs  gamma  
+# in the list  GeneralizedOrbitalGraphs(G,k)  (though not necessarily
+# in the same order) for which  filter(gamma)  is  true.
+#
+# A single working graph is maintained, and each subset of the 
+# unions of paired orbitals is visited by adding or removing 
+# edge-orbits to change the previous subset into it.  When  k  is
+# true or false, the subsets are visited in Gray code order, so that
+# just one union of paired orbitals is added or removed at each step. 
+# The function  filter  is applied to the working graph, which it 
+# must not change, and only a graph satisfying  filter  is copied 
+# and returned.
+#
+local G,k,filter,n,M,m,toggle,advance,iter;
+if not (Length(arg) in [1,2,3]) then
+   Error("must have 1, 2 or 3 arguments");
+fi;
+G:=arg[1];
+if IsBound(arg[2]) then
+   k:=arg[2];
+else
+   k:=false;
+fi;
+if IsBound(arg[3]) then
+   filter:=arg[3];
+else
+   filter:=ReturnTrue;
+fi;
+if not (IsPermGroup(G) and (IsBool(k) or IsInt(k)) and IsFunction(filter)) then
+   Error("usage: IteratorOfGeneralizedOrbitalGraphs( <PermGroup> [, <Bool> or <Int> [, <Function> ]] )");
+fi;
+n:=LargestMovedPoint(G);
+if n=0 or not IsTransitive(G,[1..n]) then
+   Error("<G> must be a non-trivial transitive group on [1..LargestMovedPoint( <G> )]");
+fi;
+if not ((k in [false,true]) or (IsInt(k) and k>=0)) then 
+   Error("<k> must be in  [false,true]  or be a non-negative integer");
+fi;
+M:=GRAPE_PairedOrbitalEdges(G,n);
+m:=Length(M);
+toggle:=function(iter,i)
+   # Adds or removes the union of paired orbitals given by  M[i]. 
+   local e;
+   if i in iter.current then
+      RemoveSet(iter.current,i);
+      for e in M[i] do
+         RemoveEdgeOrbit(iter.graph,e);
+      od;
+   else
+      AddSet(iter.current,i);
+      for e in M[i] do
+         AddEdgeOrbit(iter.graph,e);
+      od;
+   fi;
+end;
+advance:=function(iter)
+   # Sets  iter.next  to the next graph to be returned, or to  fail  
+   # if there is no such graph.
+   local S,i,t;
+   repeat 
+      if IsInt(k) then
+         if IsDoneIterator(iter.combinations) then
+            iter.next:=fail;
+            return;
+         fi;
+         S:=NextIterator(iter.combinations);
+         for i in Difference(iter.current,S) do
+            toggle(iter,i);
+         od;
+         for i in Difference(S,iter.current) do
+            toggle(iter,i);
+         od;
+      else
+         t:=iter.step;
+         if t=2^m then
+            iter.next:=fail;
+            return;
+         fi;
+         iter.step:=t+1;
+         if t>0 then
+            # The t-th step of the Gray code changes the i-th element, 
+            # where  2^(i-1)  is the largest power of 2 dividing  t. 
+            i:=1;
+            while t mod 2 = 0 do
+               t:=t/2;
+               i:=i+1;
+            od;
+            toggle(iter,i);
+         fi;
+      fi;
+   until (k<>false or iter.current<>[]) and filter(iter.graph)=true;
+   iter.next:=CopyGraph(iter.graph);
+end;
+iter:=rec(graph:=NullGraph(G,n),current:=[],step:=0,
+   IsDoneIterator:=iter->iter.next=fail,
+   NextIterator:=function(iter)
+      local gamma;
+      gamma:=iter.next;
+      advance(iter);
+      return gamma;
+   end,
+   ShallowCopy:=function(iter)
+      local new;
+      new:=rec(graph:=CopyGraph(iter.graph),current:=ShallowCopy(iter.current),
+         step:=iter.step,next:=iter.next,
+         IsDoneIterator:=iter.IsDoneIterator,NextIterator:=iter.NextIterator,
+         ShallowCopy:=iter.ShallowCopy);
+      if IsBound(iter.combinations) then
+         new.combinations:=ShallowCopy(iter.combinations);
+      fi;
+      return new;
+   end);
+if IsInt(k) then
+   iter.combinations:=IteratorOfCombinations([1..m],k);
+fi;
+advance(iter);
+return IteratorByFunctions(iter);
+end);
+
 BindGlobal("CollapsedAdjacencyMat",function(arg)
 #
 # Returns the collapsed adjacency matrix  A  for  gamma=arg[2]  wrt  
@@ -1055,7 +1454,7 @@ if Length(arg)=1 then
       Error(
        "<gamma.group> not transitive on vertices of single argument <gamma>"); 
    fi;
-   G := Stabilizer(gamma.group,1);
+   G := GRAPE_PointStabilizer(gamma.group,1);
 else   
    G := arg[1];
    gamma := arg[2];
@@ -1092,7 +1491,13 @@ BindGlobal("OrbitalDigraphColadjMats",function(arg)
 #
 # If  arg[2]  is bound, then it is assumed to be  Stabilizer(G,1).
 #
-local G,H,orbs,deg,i,j,k,n,coladjmats,A,orbnum,reps,gamma;
+# All the matrices are computed in a single pass: for each suborbit
+# representative  reps[j],  we take the element  g  of  G  mapping  
+# 1  to  reps[j]  given by the Schreier vector, so that  g^-1  maps 
+# reps[j]  to  1,  and then  [reps[j],k]  is in the orbital digraph 
+# containing  [1,reps[i]]  iff  k^(g^-1)  is in the suborbit of  reps[i].  
+#
+local G,H,orbs,deg,i,j,k,n,coladjmats,orbnum,reps,gamma,gens,rw,g,img;
 G:=arg[1];
 if not IsPermGroup(G) or (IsBound(arg[2]) and not IsPermGroup(arg[2])) then
    Error("usage: OrbitalDigraphColadjMats( <PermGroup> [, <PermGroup> ] )");
@@ -1103,7 +1508,7 @@ if IsBound(arg[2]) then
       Error("<H> does not fix the point 1");
    fi;
 else
-   H:=Stabilizer(G,1);
+   H:=GRAPE_PointStabilizer(G,1);
 fi;
 deg:=Maximum(LargestMovedPoint(GeneratorsOfGroup(G)),1);
 if not IsTransitive(G,[1..deg]) then
@@ -1117,19 +1522,21 @@ if reps[1]<>1 then # this cannot happen!
    Error("internal error");
 fi;
 n:=Length(reps);
-coladjmats:=[];
-for i in [1..n] do
-   AddEdgeOrbit(gamma,[1,reps[i]],H);
-   A:=NullMat(n,n);
-   for j in [1..n] do 
-      for k in Adjacency(gamma,reps[j]) do
-	 A[j][orbnum[k]]:=A[j][orbnum[k]]+1;
-      od;
+coladjmats:=List([1..n],i->NullMat(n,n));
+gens:=GeneratorsOfGroup(G);
+for j in [1..n] do 
+   # Determine  g  mapping  1  to  reps[j],  using the Schreier vector;
+   # then  img[k]=k^(g^-1).
+   rw:=GRAPE_RepWord(gens,gamma.schreierVector,reps[j]);
+   g:=();
+   for k in rw.word do
+      g:=g*gens[k];
+   od;
+   img:=ListPerm(g^-1,deg);
+   for k in [1..deg] do
+      i:=orbnum[img[k]];
+      coladjmats[i][j][orbnum[k]]:=coladjmats[i][j][orbnum[k]]+1;
    od;
-   coladjmats[i]:=A;
-   if i < n then
-      RemoveEdgeOrbit(gamma,[1,reps[i]],H);
-   fi;
 od;
 return coladjmats;
 end);
@@ -1434,7 +1841,7 @@ BindGlobal("InducedSubgraph",function(arg)
 # gamma,  with the i-th vertex-name of the induced subgraph being the 
 # vertex-name in  gamma  of V[i].
 #
-local gamma,V,G,Ggens,gens,indu,i,j,W,VV,X;
+local gamma,V,G,Ggens,gens,indu,i,j,W,VV,X,inV;
 gamma:=arg[1];
 V:=arg[2];
 if not IsGraph(gamma) or not IsList(V) 
@@ -1457,6 +1864,7 @@ W:=[];
 for i in [1..Length(V)] do 
    W[V[i]]:=i; 
 od;
+inV:=BlistList([1..gamma.order],VV);
 Ggens:=GeneratorsOfGroup(G);
 gens:=[]; 
 for i in [1..Length(Ggens)] do 
@@ -1473,7 +1881,8 @@ else
    Unbind(indu.isSimple); 
 fi;
 for i in [1..Length(indu.representatives)] do
-   X:=W{Intersection(VV,Adjacency(gamma,V[indu.representatives[i]]))};
+   X:=Adjacency(gamma,V[indu.representatives[i]]);
+   X:=W{ListBlist(X,inV{X})};
    Sort(X);
    indu.adjacencies[i]:=X;
 od;
@@ -2110,7 +2519,7 @@ BindGlobal("ComplementGraph",function(arg)
 # Returns the complement of the graph  gamma=arg[1]. 
 # arg[2] is true iff loops/nonloops are to be complemented (default:false).
 #
-local gamma,comploops,i,delta,notnecsimple;
+local gamma,comploops,i,delta,notnecsimple,vertices,b;
 gamma:=arg[1];
 if IsBound(arg[2]) then
    comploops:=arg[2];
@@ -2135,15 +2544,20 @@ if IsBound(gamma.isSimple) then
       delta.isSimple:=true;
    fi;
 fi;
+vertices:=[1..gamma.order];
 for i in [1..Length(delta.representatives)] do 
-   delta.adjacencies[i]:=Difference([1..gamma.order],gamma.adjacencies[i]);
+   # Complement the adjacency set as a boolean list, so that no 
+   # intermediate lists of vertices are created.
+   b:=BlistList(vertices,gamma.adjacencies[i]);
    if not comploops then
-      RemoveSet(delta.adjacencies[i],delta.representatives[i]);
-      if notnecsimple and (gamma.representatives[i] in gamma.adjacencies[i])
-       then
-	 AddSet(delta.adjacencies[i],delta.representatives[i]);
-      fi;
+      # the loop at the representative is kept iff it is in  gamma  
+      # and  gamma  is not necessarily simple
+      b[delta.representatives[i]]:=not (notnecsimple and 
+         b[delta.representatives[i]]);
    fi;
+   FlipBlist(b);
+   delta.adjacencies[i]:=ListBlist(vertices,b);
+   IsSSortedList(delta.adjacencies[i]);
 od;
 return delta;
 end);
@@ -2220,7 +2634,7 @@ BindGlobal("EdgeGraph",function(gamma)
 # vertices, and  e  is joined to  f  in delta precisely when 
 # e<>f,  and  e,f  have a common vertex in  gamma.
 #
-local delta,i,j,k,edgeset,adj,r,e,f;
+local delta,i,p,edgeset,incident,adj,r,e;
 if not IsGraph(gamma) then 
    Error("usage: EdgeGraph( <Graph> )");
 fi;
@@ -2230,18 +2644,20 @@ fi;
 edgeset:=UndirectedEdges(gamma);
 delta:=NullGraph(Action(gamma.group,edgeset,OnSets),Length(edgeset));
 delta.names:=Immutable(List(edgeset,e->List(e,i->VertexName(gamma,i))));
+# incident[v]  is the list of the positions in  edgeset  of the edges
+# containing the vertex  v.
+incident:=List([1..gamma.order],v->[]);
+for p in [1..Length(edgeset)] do
+   e:=edgeset[p];
+   Add(incident[e[1]],p);
+   Add(incident[e[2]],p);
+od;
 for i in [1..Length(delta.representatives)] do
    r:=delta.representatives[i];
    e:=edgeset[r];
-   adj:=delta.adjacencies[i];
-   for k in [1,2] do
-      for j in Adjacency(gamma,e[k]) do
-	 f:=SSortedList([e[k],j]);
-	 if e<>f then
-	    AddSet(adj,PositionSet(edgeset,f));
-	 fi;
-      od;
-   od;
+   adj:=Set(Concatenation(incident[e[1]],incident[e[2]]));
+   RemoveSet(adj,r);
+   delta.adjacencies[i]:=adj;
 od;
 return delta;
 end);
@@ -2256,7 +2672,8 @@ BindGlobal("QuotientGraph",function(gamma,R)
 # classes of  S,  and  [X,Y]  is an edge of  delta  iff  
 # [x,y]  is an edge of  gamma  for some  x in X,  y in Y.
 #
-local root,Q,F,V,W,i,j,r,q,x,y,names,gens,delta,g,h,m,pos;
+local root,union,Q,F,rank,V,W,cls,i,j,r,q,names,gens,delta,g,h,m,pos,
+      reppos;
 
 root := function(x)
 #
@@ -2279,6 +2696,29 @@ od;
 return -t;
 end;
 
+union := function(x,y)
+#
+# Merges the trees containing  x  and  y,  if these are different,
+# making the root of smaller rank a child of the other root, and 
+# recording in  Q  the root which becomes a child.
+#
+x:=root(x);
+y:=root(y);
+if x=y then
+   return;
+fi;
+if rank[x]<rank[y] then
+   F[x]:=y;
+   Add(Q,x);
+else
+   F[y]:=x;
+   Add(Q,y);
+   if rank[x]=rank[y] then
+      rank[x]:=rank[x]+1;
+   fi;
+fi;
+end;
+
 if not IsGraph(gamma) or not IsList(R) then
    Error("usage: QuotientGraph( <Graph>, <List> )");
 fi;
@@ -2294,72 +2734,63 @@ F:=[];
 for i in [1..gamma.order] do
    F[i]:=-i;
 od;
+rank:=ListWithIdenticalEntries(gamma.order,0);
 Q:=[];
 for r in R do
-   x:=root(r[1]);
-   y:=root(r[2]);
-   if x<>y then
-      if x>y then
-	 Add(Q,x);
-	 F[x]:=y;
-      else
-	 Add(Q,y);
-	 F[y]:=x;
-      fi;
-   fi;
+   union(r[1],r[2]);
 od;
+# Each element  q  of  Q  was merged with its parent  F[q]  at the time,
+# so we must also merge the images of  q  and  F[q]  under each 
+# generator, and  F[q]  remains in the same class as  q.
 for q in Q do 
    for g in GeneratorsOfGroup(gamma.group) do
-      x:=root(F[q]^g);
-      y:=root(q^g);
-      if x<>y then
-	 if x>y then
-	    Add(Q,x);
-	    F[x]:=y;
-	 else
-	    Add(Q,y);
-	    F[y]:=x;
-	 fi;
-      fi;
+      union(F[q]^g,q^g);
    od;
 od;
-for i in Reversed([1..gamma.order]) do
-   if F[i] < 0 then
-      F[i]:=-F[i];
-   else
-      F[i]:=root(F[i]);
-   fi;
-od;
-V:=SSortedList(F);
+# Now number the classes in the order of their least elements. 
+# The i-th class has least element  V[i],  and  cls[j]  is the number 
+# of the class containing  j.
+V:=[];
 W:=[];
+cls:=[];
 names:=[];
-m:=Length(V);
-for i in [1..m] do
-   W[V[i]]:=i;
-   names[i]:=[];
-od;
 for i in [1..gamma.order] do
-   Add(names[W[F[i]]],VertexName(gamma,i));
+   r:=root(i);
+   if not IsBound(W[r]) then
+      Add(V,i);
+      W[r]:=Length(V);
+      names[Length(V)]:=[];
+   fi;
+   cls[i]:=W[r];
+   Add(names[cls[i]],VertexName(gamma,i));
 od; 
+m:=Length(V);
 gens:=[];
 for g in GeneratorsOfGroup(gamma.group) do
    h:=[];
    for i in [1..m] do
-      h[i]:=W[F[V[i]^g]];
+      h[i]:=cls[V[i]^g];
    od;
    Add(gens,PermList(h));
 od;
 delta:=NullGraph(Group(gens,()),m);
 delta.names:=Immutable(names);
-IsSSortedList(delta.representatives);
+# reppos[k]  is the position of  k  in  delta.representatives,  if any.
+reppos:=[];
+for i in [1..Length(delta.representatives)] do
+   reppos[delta.representatives[i]]:=i;
+od;
 for i in [1..gamma.order] do
-   pos:=PositionSet(delta.representatives,W[F[i]]);
-   if pos<>fail then
+   if IsBound(reppos[cls[i]]) then
+      pos:=reppos[cls[i]];
       for j in Adjacency(gamma,i) do
-	 AddSet(delta.adjacencies[pos],W[F[j]]);
+	 Add(delta.adjacencies[pos],cls[j]);
       od;
    fi;
 od;
+for i in [1..Length(delta.adjacencies)] do
+   delta.adjacencies[i]:=Set(delta.adjacencies[i]);
+od;
 if IsLoopy(delta) then
    delta.isSimple:=false;
 elif IsBound(gamma.isSimple) and gamma.isSimple then
@@ -2739,6 +3170,76 @@ od;
 return delta;
 end);
 
+BindGlobal("GRAPE_CheckpointStart",function(key)
+#
+# This function, not for the user, begins checkpointing for a
+# search identified by  key  (a list which determines the search
+# and its parameters).  It returns  fail  if  GRAPE_CHECKPOINT_FILE=fail
+# or if we are within a search which is already being checkpointed
+# (signalled by the option  GRAPE_checkpointing).  Otherwise a record  cp
+# is returned, in which  cp.saved  is the state saved in
+# GRAPE_CHECKPOINT_FILE  by an interrupted run of the same search,
+# or  fail  if there is no such saved state.
+#
+local f,saved;
+if GRAPE_CHECKPOINT_FILE=fail or ValueOption("GRAPE_checkpointing")=true then
+   return fail;
+fi;
+if not IsString(GRAPE_CHECKPOINT_FILE) then
+   Error("<GRAPE_CHECKPOINT_FILE> must be a string or fail");
+fi;
+saved:=fail;
+if IsExistingFile(GRAPE_CHECKPOINT_FILE) then
+   f:=ReadAsFunction(GRAPE_CHECKPOINT_FILE);
+   if f<>fail then
+      saved:=f();
+      if not (IsRecord(saved) and IsBound(saved.key) and saved.key=key) then
+         # the file belongs to some other computation
+         saved:=fail;
+      fi;
+   fi;
+fi;
+return rec(key:=key,saved:=saved,written:=false,time:=Runtime());
+end);
+
+BindGlobal("GRAPE_CheckpointSave",function(cp,state)
+#
+# This function, not for the user, writes the record  state  to
+# GRAPE_CHECKPOINT_FILE,  provided  cp<>fail  and at least
+# GRAPE_CHECKPOINT_INTERVAL  seconds have passed since  cp  was
+# started or last saved.  The state is first written to a temporary
+# file which then replaces  GRAPE_CHECKPOINT_FILE,  so that an
+# interruption while writing does not destroy the previous state.
+#
+local tmp,mv;
+if cp=fail or Runtime()-cp.time < 1000*GRAPE_CHECKPOINT_INTERVAL then
+   return;
+fi;
+state:=ShallowCopy(state);
+state.key:=cp.key;
+tmp:=Concatenation(GRAPE_CHECKPOINT_FILE,".tmp");
+PrintTo(tmp,"return ",state,";\n");
+mv:=Filename(DirectoriesSystemPrograms(),"mv");
+if mv=fail or GRAPE_Exec(mv,["-f",tmp,GRAPE_CHECKPOINT_FILE],
+                         InputTextNone(),OutputTextNone())<>0 then
+   # no  mv  available, so write the file directly
+   PrintTo(GRAPE_CHECKPOINT_FILE,"return ",state,";\n");
+   RemoveFile(tmp);
+fi;
+cp.written:=true;
+cp.time:=Runtime();
+end);
+
+BindGlobal("GRAPE_CheckpointFinish",function(cp)
+#
+# This function, not for the user, removes the checkpoint file of
+# a completed search, if that search wrote or read the file.
+#
+if cp<>fail and (cp.written or cp.saved<>fail) then
+   RemoveFile(GRAPE_CHECKPOINT_FILE);
+fi;
+end);
+
 BindGlobal("CompleteSubgraphsMain",function(gamma,kvector,allsubs,allmaxes,
                                       partialcolour,weightvectors,dovector)
 #
@@ -2838,7 +3339,8 @@ BindGlobal("CompleteSubgraphsMain",function(gamma,kvector,allsubs,allmaxes,
 #
 local IsFixedPoint,HasLargerEntry,k,smallorder,smallorder1,weights,weighted,
       originalG,originalgamma,includingallmaximalreps,zeroonevectorweighted, 
-      CompleteSubgraphsSearch,K,clique,cliquenumber,chromaticnumber;
+      CompleteSubgraphsSearch,K,clique,cliquenumber,chromaticnumber,
+      checkpoint,savedans,reps;
 
 IsFixedPoint := function(G,point)
 #
@@ -2869,7 +3371,7 @@ CompleteSubgraphsSearch := function(gamma,kvector,sofar,forbidden)
 #
 # The variables  smallorder,  smallorder1,  originalG,  
 # allsubs,  allmaxes,  weights,  weightvectors,  weighted, 
-# partialcolour,  dovector,  IsFixedPoint,  and  HasLargerEntry  
+# partialcolour,  dovector,  checkpoint,  IsFixedPoint,  and  HasLargerEntry  
 # are global to this function.  (originalG  is the group of
 # automorphisms associated with the graph  gamma  on the initial call 
 # from  CompleteSubgraphsMain.)  
@@ -2899,6 +3401,11 @@ CompleteSubgraphsSearch := function(gamma,kvector,sofar,forbidden)
 # No returned clique will have a vertex in the given parameter  forbidden.
 # The value of  forbidden  may be changed by this function.
 #
+# When  sofar=[]  (the top level of the search), the current values
+# of  forbidden  and of the solutions found so far are saved
+# via  checkpoint  after each completed branch, so that an interrupted
+# search can be resumed by a call with that value of  forbidden.
+#
 # If  allsubs=0:  this function returns (a list of) 
 # at most one complete subgraph, and returns a list  c  of one
 # complete subgraph if and only if  c union sofar  is a solution
@@ -2942,10 +3449,10 @@ CompleteSubgraphsSearch := function(gamma,kvector,sofar,forbidden)
 # pp. 88-95.
 #
 local k,n,i,j,delta,adj,rep,a,b,ans,ans1,ans2,names,W,H,HH,newsofar,
-      G,orb,kk,ll,mm,active,nadj,verticesremoved,J,doposition,
+      G,orb,kk,ll,mm,active,nadj,verticesremoved,J,doposition,done,
       A,nactive,nactivevector,wt,indorbwtsum,CompleteSubgraphsSearch1;
 
-CompleteSubgraphsSearch1 := function(mask,kvector,forbidmask)
+CompleteSubgraphsSearch1 := function(mask,kvector,forbidmask,top)
 #
 # This function does the work of  CompleteSubgraphsSearch,   
 # but assuming the group associated to the graph is trivial.
@@ -2967,6 +3474,11 @@ CompleteSubgraphsSearch1 := function(mask,kvector,forbidmask)
 # The parameter  mask  may be changed by this function, and if 
 # allmaxes=true  then  forbidmask  may be changed by this function.
 #
+# The boolean parameter  top  is true iff this is the top level of a 
+# search which is being checkpointed, in which case the names of the 
+# vertices from which the search is complete are added to the global  
+# variable  done,  and the state of the search is saved via  checkpoint.
+#
 local k,active,activemask,a,b,c,col,verticesremoved,i,j,ans,ans1,kk,ll,mm,
       vertices,nactive,nactivevector,wt,wtvector,cw,cwsum,endconsider,nadj,
       doposition,minptr;
@@ -3229,7 +3741,7 @@ for i in active{[1..endconsider]} do
    wtvector:=weightvectors[names[i]];
    ans1:=CompleteSubgraphsSearch1(IntersectionBlist(mask,A[i]),
                  kvector-wtvector,
-                 IntersectionBlist(forbidmask,A[i]));
+                 IntersectionBlist(forbidmask,A[i]),false);
    if Length(ans1)>0 then
       for a in ans1 do
          Add(a,names[i]);
@@ -3248,6 +3760,12 @@ for i in active{[1..endconsider]} do
    else
       mask[i]:=false;
    fi;
+   if top then
+      Add(done,names[i]);
+      GRAPE_CheckpointSave(checkpoint,
+         rec(forbidden:=Union(forbidden,done),
+             ans:=Concatenation(savedans,ans)));
+   fi;
 od;
 return ans;
 end;
@@ -3294,8 +3812,10 @@ if IsTrivial(G) or ((not weighted) and Size(G)<=smallorder1) then
    fi;
    A:=List([1..n],i->BlistList([1..n],Adjacency(gamma,i)));
    # So now  A  is the bit-adjacency-matrix of  gamma.
+   done:=[];
    ans1:=CompleteSubgraphsSearch1(BlistList([1..n],[1..n]), kvector,
-            BlistList([1..n],Difference([1..n],active)));
+            BlistList([1..n],Difference([1..n],active)), 
+            sofar=[] and checkpoint<>fail and IsTrivial(G));
    Unbind(A); # A is no longer needed
    if Length(ans1)<=1 or IsTrivial(gamma.group) then
       # no isomorph rejection is required
@@ -3505,8 +4025,9 @@ for j in [1..Length(J)] do
                      Intersection(delta.names,forbidden));
          else
             # allsubs=2 
-            delta:=InducedSubgraph(gamma,adj,Stabilizer(gamma.group,rep));
-            HH:=Stabilizer(originalG,newsofar,OnSets);
+            delta:=InducedSubgraph(gamma,adj,
+                                   GRAPE_PointStabilizer(gamma.group,rep));
+            HH:=GRAPE_SetStabilizer(originalG,newsofar);
             if not IsFixedPoint(HH,names[rep]) then 
                H:=Action(HH,names{adj},OnPoints);
                delta:=NewGroupGraph(H,delta);
@@ -3568,6 +4089,11 @@ for j in [1..Length(J)] do
                fi;
             od;
             UniteSet(forbidden,names{orb});
+            if sofar=[] then
+               GRAPE_CheckpointSave(checkpoint,
+                  rec(forbidden:=forbidden,
+                      ans:=Concatenation(savedans,ans)));
+            fi;
          fi;
       fi;
    fi;
@@ -3589,7 +4115,7 @@ fi;
 if not IsSimpleGraph(gamma) then
    Error("<gamma> must be a simple graph");
 fi;
-smallorder:=8; # to try to optimize isomorph rejection. 
+smallorder:=GRAPE_CLIQUES_SMALLORDER; # to try to optimize isomorph rejection. 
 # If allsubs=2, we perform isomorph rejection via explicit orbits 
 # on cliques when the group associated with the graph under 
 # consideration has  order<=smallorder. 
@@ -3652,11 +4178,45 @@ if not weighted and k>=0 then
 fi;
 zeroonevectorweighted:=weightvectors<>[] and Length(weightvectors[1])>1 and
    ForAll(weightvectors,x->ForAll(x,y->y<=1));
-K:=CompleteSubgraphsSearch(gamma,kvector,[],[]);
+checkpoint:=GRAPE_CheckpointStart(["CompleteSubgraphsMain",gamma.order,
+   GeneratorsOfGroup(gamma.group),gamma.representatives,gamma.adjacencies,
+   kvector,allsubs,allmaxes,partialcolour,weightvectors,dovector]);
+if checkpoint<>fail and checkpoint.saved<>fail then
+   # Resume an interrupted search: all the required solutions containing
+   # an element of  checkpoint.saved.forbidden  are in  checkpoint.saved.ans.
+   # These are kept in  savedans,  so that any state saved by the resumed
+   # search includes them.
+   savedans:=List(checkpoint.saved.ans,ShallowCopy);
+   K:=CompleteSubgraphsSearch(gamma,kvector,[],
+         Set(checkpoint.saved.forbidden) : GRAPE_checkpointing:=true);
+   K:=Concatenation(savedans,K);
+else
+   savedans:=[];
+   K:=CompleteSubgraphsSearch(gamma,kvector,[],[] 
+         : GRAPE_checkpointing:=true);
+fi;
 for clique in K do
    Sort(clique); 
 od;
 Sort(K);
+if checkpoint<>fail and checkpoint.saved<>fail then
+   # Remove duplicates, and if  allsubs=2,  isomorphs, which can arise 
+   # when combining the saved solutions with the new ones.
+   K:=Set(K);
+   if allsubs=2 and not IsTrivial(gamma.group) then
+      reps:=[];
+      K:=Filtered(K,function(x)
+                       local y;
+                       y:=SmallestImageSet(gamma.group,x);
+                       if y in reps then
+                          return false;
+                       fi;
+                       AddSet(reps,y);
+                       return true;
+                    end);
+   fi;
+fi;
+GRAPE_CheckpointFinish(checkpoint);
 if not weighted and not IsBound(originalgamma.maximumClique) then 
    if includingallmaximalreps then 
       #  K  contains a maximum clique of  originalgamma.
@@ -3790,7 +4350,7 @@ fi;
 L:=[];
 S:=[];
 for clique in K do
-   A:=Stabilizer(gamma.group,clique,OnSets);
+   A:=GRAPE_SetStabilizer(gamma.group,clique);
    if Size(G)=Size(A) or IsCyclic(A) or
       (Gcd(Size(G),Size(A)/Size(G))=1 and (IsSupersolvableGroup(G) or IsSolvableGroup(A))) then 
       # G is a "friendly" subgroup of A.
@@ -3998,7 +4558,7 @@ BindGlobal("CayleyGraph",function(arg)
 # above (as long as  gens  is contained in  G), but returns a 
 # "Cayley graph" which is not connected.
 # 
-local G,gens,elms,undirected,caygraph;
+local G,gens,elms,undirected,caygraph,x,adj;
 G:=arg[1];
 if IsBound(arg[2]) then 
    gens:=arg[2];
@@ -4018,15 +4578,31 @@ SetSize(G,Length(elms));
 if not IsSSortedList(gens) then
    gens:=SSortedList(gens);
 fi;
-caygraph := Graph(G,elms,OnRight,
-		  function(x,y) return y*x^-1 in gens; end,true);
+#
+# We construct directly the graph which would be returned by
+# Graph(G,elms,OnRight,function(x,y) return y*x^-1 in gens; end,true),
+# possibly followed by  UnderlyingGraph.  The right regular action of  G
+# on  elms  is transitive, so the graph has just one representative 
+# vertex  x,  and the vertices joined to  x  are the  g*x  for  g  in  
+# gens  (and also the  g^-1*x  if  undirected=true). 
 #
 # Note that  caygraph.group  comes from the right regular action of
 # G  as a group of automorphisms of the Cayley graph constructed.  
 #
+caygraph:=NullGraph(Action(G,elms,OnRight),Length(elms));
+Unbind(caygraph.isSimple);
+caygraph.names:=Immutable(elms);
+GRAPE_ActionStabChain(caygraph.group,G);
 SetSize(caygraph.group,caygraph.order);
+x:=elms[caygraph.representatives[1]];
+adj:=List(gens,g->Position(elms,g*x));
 if undirected then
-  caygraph:=UnderlyingGraph(caygraph);
+   Append(adj,List(gens,g->Position(elms,g^-1*x)));
+fi;
+adj:=Set(Filtered(adj,IsInt));
+caygraph.adjacencies[1]:=adj;
+if undirected then
+   caygraph.isSimple:=not (caygraph.representatives[1] in adj);
 fi;
 return caygraph;
 end);
@@ -4045,7 +4621,7 @@ BindGlobal("SwitchedGraph",function(arg)
 # If  arg[3]  is bound then it is assumed to be a subgroup 
 # of  Aut(gamma)  stabilizing  V  setwise.
 #
-local gamma,delta,n,V,W,H,A,i;
+local gamma,delta,n,V,W,H,A,B,i;
 gamma:=arg[1];
 V:=arg[2];
 if IsInt(V) then
@@ -4084,14 +4660,23 @@ fi;
 if IsBound(gamma.names) then
    delta.names:=Immutable(gamma.names);
 fi;
-W:=Difference([1..n],V);
+# 
+# The new adjacency set of a vertex  x  not in  V  is the symmetric 
+# difference of its old adjacency set with  V,  and that of a vertex  x
+# in  V  is the complement of this symmetric difference. We compute 
+# these using boolean lists, to avoid creating intermediate lists.
+#
+W:=BlistList([1..n],V);
 for i in [1..Length(delta.representatives)] do
-   A:=Adjacency(gamma,delta.representatives[i]);
-   if delta.representatives[i] in V then
-      delta.adjacencies[i]:=Union(Intersection(A,V),Difference(W,A));
-   else
-      delta.adjacencies[i]:=Union(Intersection(A,W),Difference(V,A));
+   A:=BlistList([1..n],Adjacency(gamma,delta.representatives[i]));
+   B:=IntersectionBlist(A,W);
+   UniteBlist(A,W);
+   SubtractBlist(A,B);
+   if W[delta.representatives[i]] then
+      FlipBlist(A);
    fi;
+   delta.adjacencies[i]:=ListBlist([1..n],A);
+   IsSSortedList(delta.adjacencies[i]);
 od;
 return delta;
 end);
@@ -4130,7 +4715,23 @@ BindGlobal("VertexTransitiveDRGs",function(gpin)
 # May 2018: The efficiency of this function has been improved for 
 # the case when not all G-orbitals are self-paired.
 #
-local coladjmats,include,i,j,M,C,rank,comb,loc,sum,degree,prim,result;
+# The unions of paired orbitals are combined by a depth-first search,
+# in the same order as  Combinations,  and the sum of the collapsed 
+# adjacency matrices is updated as each union is added. A combination  
+# is not extended if, for the graph  gamma  of some extension, the 
+# numbers of common neighbours of vertex 1 and the representatives
+# of the suborbits already included could not all be equal (as they 
+# must be if  gamma  is distance-regular). The searches starting with
+# each union of paired orbitals are made in parallel if 
+# GRAPE_NUMBER_OF_JOBS>1  (see  GRAPE_ParList).  If the option 
+# statistics  is set, then  result.statistics  is a record whose 
+# components  nodes  and  pruned  are lists, such that  nodes[d]  is 
+# the number of combinations of  d  unions of paired orbitals which
+# were checked, and  pruned[d]  is the number of combinations not 
+# checked because a combination of  d  unions could not be extended.
+#
+local coladjmats,include,i,j,M,rank,degree,prim,result,m,suffix,
+      search,branch,branches,t,d;
 if not IsList(gpin) and not IsPermGroup(gpin) then
    Error("usage: VertexTransitiveDRGs( <List> or <PermGroup> )");
 fi;
@@ -4181,18 +4782,67 @@ for i in [1..rank] do
       include[j]:=false;
    fi;
 od;
-for comb in Combinations(M) do
-   if comb<>[] then
-      C:=Union(comb);
-      sum:=Sum(coladjmats{C});
-      loc:=LocalInfoMat(sum,1);
-      if loc.localDiameter <> -1 and not (-1 in Flat(loc.localParameters)) then
-         # We've found a DRG.
-         Add(result.orbitalCombinations,C);
-         Add(result.intersectionArrays,loc.localParameters);
-      fi;
+m:=Length(M);
+# suffix[t]  is the sum of the collapsed adjacency matrices for the
+# orbitals in  M[t],...,M[m].
+suffix:=[];
+suffix[m+1]:=NullMat(rank,rank);
+for t in Reversed([1..m]) do
+   suffix[t]:=suffix[t+1]+Sum(coladjmats{M[t]});
+od;
+search:=function(C,sum,last,depth,found,stats)
+   #
+   # Here  C  is the union of the chosen unions of paired orbitals,
+   # the last of which is  M[last],  and  depth  is the number of 
+   # these.  Also,  sum  is the sum of the matrices for the orbitals 
+   # in  C.  Each DRG found is added to  found.
+   #
+   local loc,U,upper,lambdas,t;
+   stats.nodes[depth]:=stats.nodes[depth]+1;
+   loc:=LocalInfoMat(sum,1);
+   if loc.localDiameter <> -1 and not (-1 in Flat(loc.localParameters)) then
+      # We've found a DRG.
+      Add(found,[C,loc.localParameters]);
    fi;
+   if last=m then
+      return;
+   fi;
+   # The number of common neighbours of 1 and a representative of the
+   # i-th suborbit, for  i  in  C,  can only increase when C is 
+   # extended, and is at most its value when all of  M[last+1],...,M[m]  
+   # are added.
+   U:=Union(C,Concatenation(M{[last+1..m]}));
+   upper:=sum+suffix[last+1];
+   lambdas:=List(C,i->Sum(sum[i]{C}));
+   if Maximum(lambdas) > Minimum(List(C,i->Sum(upper[i]{U}))) then
+      stats.pruned[depth]:=stats.pruned[depth]+2^(m-last)-1;
+      return;
+   fi;
+   for t in [last+1..m] do
+      search(Union(C,M[t]),sum+Sum(coladjmats{M[t]}),t,depth+1,found,stats);
+   od;
+end;
+branch:=function(t)
+   # Returns the DRGs found and the statistics of the search for the
+   # combinations whose first union of paired orbitals is  M[t]. 
+   local found,stats;
+   found:=[];
+   stats:=rec(nodes:=ListWithIdenticalEntries(m,0),
+              pruned:=ListWithIdenticalEntries(m,0));
+   search(Set(M[t]),Sum(coladjmats{M[t]}),t,1,found,stats);
+   return [found,stats];
+end;
+branches:=GRAPE_ParList([1..m],branch);
+for t in [1..m] do
+   for d in branches[t][1] do
+      Add(result.orbitalCombinations,d[1]);
+      Add(result.intersectionArrays,d[2]);
+   od;
 od;
+if ValueOption("statistics")=true then
+   result.statistics:=rec(nodes:=Sum(List(branches,b->b[2].nodes)),
+                          pruned:=Sum(List(branches,b->b[2].pruned)));
+fi;
 return result;
 end);
 
@@ -4295,9 +4945,24 @@ BindGlobal("GRAPE_ExactSetCover",function(arg)
 # of  [1..n]  by elements from  Concatenation(Orbits(G,blocks,OnSets)),  
 # if such a cover exists, and returns  `fail'  otherwise. 
 # 
-local G,blocks,n,H,gamma,hom,i,j,wts,K,leastreps,m,positions;
-if not Length(arg) in [3,4] then
-   Error("GRAPE_ExactSetCover should have 3 or 4 arguments");
+# If  mode:=arg[5]  is bound, then it must be  "first"  (the default), 
+# "all"  or  "count".  If  mode="all"  then the set of all the 
+# H-invariant exact set-covers as above is returned, and if  
+# mode="count"  then the number of these covers is returned.
+#
+# The exact cover problem is solved by Knuth's Algorithm X, using 
+# the "dancing links" data structure, directly on the incidence between 
+# the  H-orbits on  [1..n]  and the rows, which are the unions of the 
+# H-orbits (on blocks) consisting of pairwise disjoint blocks. 
+# If  mode="first"  then at the top level of the search, we only try one
+# row from each orbit of the stabilizer of the chosen  H-orbit on [1..n]
+# in the normalizer of  H  in  G.  
+#
+local G,blocks,n,H,N,mode,allblocks,marked,orb,b,i,j,m,orbnum,rowblocks,
+      rowcols,nrows,root,L,R,U,D,C,S,rowof,x,h,first,chosen,solutions,
+      count,cover,uncover,search,RootRows;
+if not Length(arg) in [3..5] then
+   Error("GRAPE_ExactSetCover should have 3, 4 or 5 arguments");
 fi;
 n:=arg[3];
 if not (IsInt(n) and n>=0) then
@@ -4320,40 +4985,279 @@ if IsBound(arg[4]) then
 else
    H:=Group(());
 fi;
-if n=0 then
-   return [];
-elif blocks=[] then
-   return fail;
+if IsBound(arg[5]) then
+   mode:=arg[5];
+   if not mode in ["first","all","count"] then
+      Error("<mode> must be \"first\", \"all\" or \"count\"");
+   fi;
+else
+   mode:="first";
 fi;
-gamma:=Graph(G,blocks,OnSets,function(x,y) return Intersection(x,y)=[]; end);
-if Size(H)>1 then
-   hom:=ActionHomomorphism(G,VertexNames(gamma),OnSets);
-   gamma:=CollapsedCompleteOrbitsGraph(Image(hom,H),gamma,
-      Image(hom,Normalizer(G,H)));
+if n=0 or blocks=[] then
+   if mode="first" then
+      if n=0 then
+         return [];
+      else
+         return fail;
+      fi;
+   elif mode="all" then
+      if n=0 then
+         return [[]];
+      else
+         return [];
+      fi;
+   else 
+      if n=0 then
+         return 1;
+      else
+         return 0;
+      fi;
+   fi;
+fi;
+#
+# Determine the rows.
+#
+allblocks:=Set(Concatenation(Orbits(G,blocks,OnSets)));
+orbnum:=GRAPE_OrbitNumbers(H,n).orbitNumbers;
+m:=Maximum(orbnum);  # the number of  H-orbits on  [1..n]
+rowblocks:=[];
+rowcols:=[];
+if IsTrivial(H) then
+   for b in allblocks do
+      Add(rowblocks,[b]);
+      Add(rowcols,b);
+   od;
 else
-   AssignVertexNames(gamma,List(VertexNames(gamma),x->[x]));
+   marked:=BlistList([1..Length(allblocks)],[]);
+   for i in [1..Length(allblocks)] do
+      if not marked[i] then
+         orb:=Orbit(H,allblocks[i],OnSets);
+         for b in orb do
+            marked[PositionSorted(allblocks,b)]:=true;
+         od;
+         b:=Union(orb);
+         if Length(b)=Sum(orb,Length) then
+            # the blocks in  orb  are pairwise disjoint
+            Add(rowblocks,Set(orb));
+            Add(rowcols,Set(orbnum{b}));
+         fi;
+      fi;
+   od;
 fi;
-wts:=[];
-leastreps:=Set(OrbitsDomain(H,[1..n]),Minimum);
-m:=Length(leastreps);
-for i in [1..gamma.order] do
-   wts[i]:=ListWithIdenticalEntries(m,0); 
-   if Size(H)>1 then
-      positions:=List(Intersection(leastreps,Union(gamma.names[i])),
-         rep->PositionSorted(leastreps,rep));
+nrows:=Length(rowcols);
+#
+# Now set up the dancing links structure. Node  root=1  is the root, 
+# node  j+1  is the header for column  j  (corresponding to the  j-th  
+# H-orbit on  [1..n]),  and the remaining nodes are for the entries of 
+# the rows.  For a node  x,  L[x],R[x],U[x],D[x]  are its neighbours to 
+# the left, right, up, and down, C[x]  is its column header, and  
+# rowof[x]  is its row.  For a column header  h,  S[h]  is the number of 
+# rows (currently) having an entry in that column. 
+#
+root:=1;
+L:=[m+1];
+R:=[2];
+U:=[];
+D:=[];
+C:=[];
+S:=[];
+rowof:=[];
+for j in [1..m] do
+   h:=j+1;
+   L[h]:=h-1;
+   R[h]:=h+1;
+   U[h]:=h;
+   D[h]:=h;
+   C[h]:=h;
+   S[h]:=0;
+od;
+R[m+1]:=root;
+x:=m+1;
+for i in [1..nrows] do
+   first:=0;
+   for j in rowcols[i] do
+      x:=x+1;
+      h:=j+1;
+      C[x]:=h;
+      rowof[x]:=i;
+      U[x]:=U[h];
+      D[x]:=h;
+      D[U[h]]:=x;
+      U[h]:=x;
+      S[h]:=S[h]+1;
+      if first=0 then
+         first:=x;
+         L[x]:=x;
+         R[x]:=x;
+      else
+         L[x]:=x-1;
+         R[x]:=first;
+         R[x-1]:=x;
+         L[first]:=x;
+      fi;
+   od;
+od;
+
+cover:=function(c)
+#
+# Removes column  c  and all the rows having an entry in column  c.
+#
+local i,j;
+R[L[c]]:=R[c];
+L[R[c]]:=L[c];
+i:=D[c];
+while i<>c do
+   j:=R[i];
+   while j<>i do
+      U[D[j]]:=U[j];
+      D[U[j]]:=D[j];
+      S[C[j]]:=S[C[j]]-1;
+      j:=R[j];
+   od;
+   i:=D[i];
+od;
+end;
+
+uncover:=function(c)
+#
+# Undoes  cover(c).
+#
+local i,j;
+i:=U[c];
+while i<>c do
+   j:=L[i];
+   while j<>i do
+      S[C[j]]:=S[C[j]]+1;
+      U[D[j]]:=j;
+      D[U[j]]:=j;
+      j:=L[j];
+   od;
+   i:=U[i];
+od;
+R[L[c]]:=c;
+L[R[c]]:=c;
+end;
+
+RootRows:=function(c)
+#
+# Returns a boolean list  B  with  B[r]=true  iff row  r  is to be tried
+# at the top level of the search, where the column chosen there has 
+# header  c.  We keep the first row from each orbit of the stabilizer 
+# of the corresponding  H-orbit in the normalizer  N  of  H  in  G. 
+#
+local B,K,keys,key,r,rs,pts,sorted,o;
+B:=BlistList([1..nrows],[]);
+pts:=Filtered([1..n],x->orbnum[x]=c-1);
+rs:=[];
+r:=D[c];
+while r<>c do
+   Add(rs,rowof[r]);
+   r:=D[r];
+od;
+# Note that  rs  is in increasing order.
+if IsTrivial(H) then
+   # Each row consists of a single block, and  pts=[c-1].
+   K:=GRAPE_PointStabilizer(N,pts[1]);
+   keys:=[];
+   for r in rs do
+      key:=SmallestImageSet(K,rowcols[r]);
+      if not key in keys then
+         AddSet(keys,key);
+         B[r]:=true;
+      fi;
+   od;
+else
+   # Distinct rows may have the same union, so we work with the 
+   # orbits of the stabilizer on the sets of blocks forming the rows.
+   K:=GRAPE_SetStabilizer(N,pts);
+   sorted:=rowblocks{rs};
+   rs:=ShallowCopy(rs);
+   SortParallel(sorted,rs);
+   for o in Orbits(K,sorted,OnSetsSets) do
+      B[Minimum(List(o,x->rs[PositionSorted(sorted,x)]))]:=true;
+   od;
+fi;
+return B;
+end;
+
+search:=function(depth)
+#
+# Extends the partial solution  chosen{[1..depth]}  in all possible ways.
+# Returns  true  iff the search is to stop.
+#
+local c,x,r,j,allowed;
+if R[root]=root then
+   # a solution has been found
+   if mode="count" then
+      count:=count+1;
    else
-      positions:=gamma.names[i][1];
+      Add(solutions,Union(rowblocks{chosen{[1..depth]}}));
    fi;
-   for j in positions do
-      wts[i][j]:=1;
-   od;
+   return mode="first";
+fi;
+# Choose a column with the fewest rows.
+c:=R[root];
+x:=R[c];
+while x<>root do
+   if S[x]<S[c] then
+      c:=x;
+   fi;
+   x:=R[x];
 od;
-K:=CompleteSubgraphsOfGivenSize(gamma,ListWithIdenticalEntries(m,1),
-   0,true,false,wts);
-if K=[] then
-   return fail;
+if S[c]=0 then
+   return false;
+fi;
+if depth=0 and mode="first" and not IsTrivial(N) then
+   allowed:=RootRows(c);
 else
-   return Union(gamma.names{K[1]});
+   allowed:=fail;
+fi;
+cover(c);
+r:=D[c];
+while r<>c do
+   if allowed=fail or allowed[rowof[r]] then
+      chosen[depth+1]:=rowof[r];
+      j:=R[r];
+      while j<>r do
+         cover(C[j]);
+         j:=R[j];
+      od;
+      if search(depth+1) then
+         return true;
+      fi;
+      j:=L[r];
+      while j<>r do
+         uncover(C[j]);
+         j:=L[j];
+      od;
+   fi;
+   r:=D[r];
+od;
+uncover(c);
+return false;
+end;
+
+if mode="first" then
+   if IsTrivial(H) then
+      N:=G;
+   else
+      N:=Normalizer(G,H);
+   fi;
+fi;
+chosen:=[];
+solutions:=[];
+count:=0;
+search(0);
+if mode="first" then
+   if solutions=[] then
+      return fail;
+   else
+      return solutions[1];
+   fi;
+elif mode="all" then
+   return Set(solutions);
+else
+   return count;
 fi;
 end);
       
@@ -4494,7 +5398,7 @@ while s*k>=delta.order do
    fi;
    for c in C do
       A:=Difference(Vertices(delta),c);
-      newdelta:=InducedSubgraph(delta,A,Stabilizer(delta.group,c,OnSets));
+      newdelta:=InducedSubgraph(delta,A,GRAPE_SetStabilizer(delta.group,c));
       if exhaustive_search then 
          cov:=cliquecovering(newdelta,k-1,c,delta); 
       else
@@ -4628,6 +5532,193 @@ od;
 return true;
 end); 
 
+BindGlobal("GRAPE_DSaturColouring",function(arg)
+#
+# Let  gamma:=arg[1]  be a simple graph. 
+#
+# If  arg[2]  is unbound, then this function returns a proper 
+# vertex-colouring of  gamma  (in the format returned by 
+# VertexColouring), obtained by the DSATUR heuristic of Brelaz: 
+# repeatedly, an uncoloured vertex having the most distinct colours 
+# on its neighbours is given the least colour not on its neighbours, 
+# where ties are broken by the number of uncoloured neighbours, and 
+# then by the least vertex.
+#
+# If  k:=arg[2]  is bound, then it must be a non-negative integer, 
+# and a DSATUR backtrack search is made for a proper vertex-colouring 
+# of  gamma  using at most  k  colours. The vertices of a clique 
+# are first given the distinct colours 1,2,..., a new colour is only 
+# ever the least colour not yet used, and when colouring the first 
+# vertex  v  in the search, the colours of clique vertices in the 
+# same orbit of the stabilizer of  v  in the setwise stabilizer 
+# of the clique in  gamma.group  are tried only once. Such a 
+# colouring is returned if it exists, and `fail' is returned if not.
+# However, `false' is returned if the search is abandoned after 
+# GRAPE_DSATUR_NODE_LIMIT  search nodes.
+#
+local gamma,k,n,adj,udeg,C,cnt,sat,Q,cand,best,bestsize,i,v,c,
+      colours,maxcolour,ncoloured,stack,top,nodes,K,reps,orb,
+      select,assign,unassign;
+if not (Length(arg) in [1,2]) then
+   Error("usage: GRAPE_DSaturColouring( <Graph> [, <Int> ] )");
+fi;
+gamma:=arg[1];
+if not IsGraph(gamma) then 
+   Error("usage: GRAPE_DSaturColouring( <Graph> [, <Int> ] )");
+elif not IsSimpleGraph(gamma) then
+   Error("<arg[1]> not a simple graph");
+fi;
+if IsBound(arg[2]) then
+   k:=arg[2];
+   if not IsInt(k) then 
+      Error("usage: GRAPE_DSaturColouring( <Graph> [, <Int> ] )");
+   elif k<0 then
+      Error("<arg[2]> must be non-negative"); 
+   fi;
+fi;
+n:=gamma.order;
+if n=0 then
+   return [];
+elif IsBound(k) and k=0 then
+   return fail;
+fi;
+adj:=List([1..n],v->Adjacency(gamma,v));
+udeg:=List(adj,Length);
+C:=ListWithIdenticalEntries(n,0);
+# For each vertex  v,  cnt[v][c]  (if bound) is the number of 
+# neighbours of  v  having colour  c,  sat[v]  is the number of
+# distinct colours on the neighbours of  v,  and  udeg[v]  is
+# the number of uncoloured neighbours of  v.
+cnt:=List([1..n],v->[]);
+sat:=ListWithIdenticalEntries(n,0);
+select:=function()
+   # Returns the next vertex to colour.
+   local v,w;
+   v:=0;
+   for w in [1..n] do
+      if C[w]=0 and (v=0 or sat[w]>sat[v] or 
+                     (sat[w]=sat[v] and udeg[w]>udeg[v])) then
+         v:=w;
+      fi;
+   od;
+   return v;
+end;
+assign:=function(v,c)
+   local w;
+   C[v]:=c;
+   for w in adj[v] do
+      udeg[w]:=udeg[w]-1;
+      if not IsBound(cnt[w][c]) or cnt[w][c]=0 then
+         cnt[w][c]:=1;
+         sat[w]:=sat[w]+1;
+      else
+         cnt[w][c]:=cnt[w][c]+1;
+      fi;
+   od;
+end;
+unassign:=function(v)
+   local w,c;
+   c:=C[v];
+   C[v]:=0;
+   for w in adj[v] do
+      udeg[w]:=udeg[w]+1;
+      cnt[w][c]:=cnt[w][c]-1;
+      if cnt[w][c]=0 then
+         sat[w]:=sat[w]-1;
+      fi;
+   od;
+end;
+if not IsBound(k) then
+   # The DSATUR heuristic.
+   for i in [1..n] do
+      v:=select();
+      c:=1;
+      while IsBound(cnt[v][c]) and cnt[v][c]>0 do
+         c:=c+1;
+      od;
+      assign(v,c);
+   od;
+   return C;
+fi;
+#
+# Now for the backtrack search. First determine and colour a clique.
+#
+if IsBound(gamma.maximumClique) then
+   Q:=ShallowCopy(gamma.maximumClique);
+else
+   # Greedily determine a (hopefully large) clique.
+   Q:=[];
+   cand:=[1..n];
+   while cand<>[] do
+      best:=0;
+      bestsize:=-1;
+      for v in cand do
+         i:=Length(Intersection(adj[v],cand));
+         if i>bestsize then
+            best:=v;
+            bestsize:=i;
+         fi;
+      od;
+      Add(Q,best);
+      cand:=Intersection(cand,adj[best]);
+   od;
+fi;
+if Length(Q)>k then
+   return fail;
+fi;
+for i in [1..Length(Q)] do
+   assign(Q[i],i);
+od;
+ncoloured:=Length(Q);
+maxcolour:=Length(Q);
+# Each element of  stack  records a vertex coloured in the search,
+# the list of colours to try for that vertex, the position in that
+# list of its current colour, and the value of  maxcolour  before 
+# the vertex was coloured.
+stack:=[];
+nodes:=0;
+while ncoloured<n do
+   nodes:=nodes+1;
+   if nodes>GRAPE_DSATUR_NODE_LIMIT then
+      return false;
+   fi;
+   v:=select();
+   colours:=Filtered([1..Minimum(maxcolour+1,k)],
+      c->not IsBound(cnt[v][c]) or cnt[v][c]=0);
+   if stack=[] and Length(Q)>1 and not IsTrivial(gamma.group) then
+      # Use the symmetry of  gamma  fixing  v  and the clique.
+      K:=GRAPE_PointStabilizer(GRAPE_SetStabilizer(gamma.group,Q),v);
+      reps:=[];
+      for orb in Orbits(K,Set(Q)) do
+         Add(reps,Minimum(List(orb,w->Position(Q,w))));
+      od;
+      colours:=Filtered(colours,c->c>Length(Q) or c in reps);
+   fi;
+   Add(stack,rec(vertex:=v,colours:=colours,pos:=0,maxcolour:=maxcolour));
+   # Now colour the next vertex, backtracking as necessary.
+   while stack<>[] do
+      top:=stack[Length(stack)];
+      if top.pos>0 then
+         unassign(top.vertex);
+         ncoloured:=ncoloured-1;
+      fi;
+      top.pos:=top.pos+1;
+      if top.pos<=Length(top.colours) then
+         c:=top.colours[top.pos];
+         assign(top.vertex,c);
+         ncoloured:=ncoloured+1;
+         maxcolour:=Maximum(top.maxcolour,c);
+         break;
+      fi;
+      Unbind(stack[Length(stack)]);
+   od;
+   if stack=[] then
+      return fail;
+   fi;
+od;
+return C;
+end);
+
 BindGlobal("VertexColouring",function(arg)
 #
 # Let  gamma:=arg[1]  be a simple graph. Then this function returns 
@@ -4642,6 +5733,9 @@ BindGlobal("VertexColouring",function(arg)
 # iff no such colouring exists.
 #
 # If  arg[2]  is unbound then a greedy algorithm only is used. 
+# Otherwise, if the greedy algorithm does not succeed, a DSATUR 
+# search of limited size is tried, and then if necessary, the
+# problem is reduced to clique covering.
 #
 # If  arg[3]  is bound then it must be a non-negative integer, such that
 # there is no monochromatic set of vertices of size > arg[3]  in  
@@ -4771,6 +5865,24 @@ if maxcolour<=k then
    return C;
 fi;
 # Otherwise, we need to work harder. 
+# First try a DSATUR search of limited size.
+if GRAPE_DSATUR_NODE_LIMIT>0 then
+   C:=GRAPE_DSaturColouring(gamma,k);
+   if C=fail then
+      return fail;
+   elif C<>false then
+      if not IsVertexColouring(gamma,C,k) then
+         # This should not happen!
+         Error("BUG: <C> should be a (proper) vertex <k>-colouring of <gamma>");
+      fi;
+      if IsBound(gamma.maximumClique) and Length(gamma.maximumClique)=Length(Set(C)) then
+         #  C  is a minimum vertex-colouring of  gamma.
+         gamma.minimumVertexColouring:=Immutable(C);
+      fi;
+      return C;
+   fi;
+fi;
+# Otherwise, the DSATUR search was abandoned, and we use clique coverings.
 if IsBound(arg[3]) then 
    cov:=GRAPE_CliqueCovering(ComplementGraph(gamma),k,arg[3]);
 else
@@ -4816,6 +5928,10 @@ elif IsCompleteGraph(gamma) then
 fi;
 delta:=ComplementGraph(gamma); 
 C:=GRAPE_NumbersToSets(VertexColouring(delta)); 
+CC:=GRAPE_NumbersToSets(GRAPE_DSaturColouring(delta));
+if Length(CC)<Length(C) then
+   C:=CC;
+fi;
 Sort(C); 
 # Now  C  is a partition of the vertex set of  gamma  into  
 # Length(C)  cliques. 
@@ -5097,7 +6213,7 @@ BindGlobal("SetAutGroupCanonicalLabellingNauty",function(gr,setcanon)
 # of the graph or graph with colour-classes  gr.
 # Uses the nauty system. 
 #
-  local gamma,col,ftmp1,ftmp2,fdre,fg,status,
+  local gamma,col,ftmp1,ftmp2,fdre,fg,status,invar,
         ftmp1_stream,fdre_stream,out_stream,gp;
   if IsBound(gr.canonicalLabelling) then
     setcanon:=false;
@@ -5146,20 +6262,24 @@ BindGlobal("SetAutGroupCanonicalLabellingNauty",function(gr,setcanon)
   fi;
   SetPrintFormattingStatus(fdre_stream,false);
   PrintStreamNautyGraph(fdre_stream,gamma,col);
+  if not IsSimpleGraph(gamma) then
+    invar:="*=13,k=1 10,";
+  elif GRAPE_NAUTY_INVARIANT_BUDGET>0 then
+    # the adaptive vertex-invariant, at the top two levels of the search
+    invar:=Concatenation("*=17,K=",String(GRAPE_NAUTY_INVARIANT_BUDGET),
+                         ",k=0 2,");
+  else
+    invar:="";
+  fi;
   if not setcanon then
     # only the automorphism group is computed
-    if IsSimpleGraph(gamma) then
-      AppendTo( fdre_stream, "> ", ftmp1, " p,xq\n" );
-    else
-      AppendTo( fdre_stream, "> ", ftmp1, " p,*=13,k=1 10,xq\n" );
+    if GRAPE_NAUTY_THREADS>1 then
+      AppendTo( fdre_stream, "Q=", GRAPE_NAUTY_THREADS, "\n" );
     fi;
+    AppendTo( fdre_stream, "> ", ftmp1, " p,", invar, "xq\n" );
   else
-    if IsSimpleGraph(gamma) then
-      AppendTo( fdre_stream, "> ", ftmp1, " p,cx\n>> ", ftmp2, " bq\n" );
-    else
-      AppendTo( fdre_stream, "> ", ftmp1, " p,*=13,k=1 10,cx\n>> ", ftmp2,
-               " bq\n" );
-    fi;
+    AppendTo( fdre_stream, "> ", ftmp1, " p,", invar, "cx\n>> ", ftmp2,
+             " bq\n" );
   fi;
   CloseStream(fdre_stream);
   PrintTo(ftmp2,gamma.order,"\n"); # initialize ftmp2
@@ -5706,8 +6826,19 @@ BindGlobal("PartialLinearSpaces",function(arg)
 # of the (s+1)-cliques of  ptgraph.  If known, this can help the function
 # to run faster. 
 # 
+# If  GRAPE_CHECKPOINT_FILE<>fail  then the state of the search is
+# saved in that file after each completed choice of the lines through
+# the first point, and an interrupted search is resumed from there.
+# 
+# Otherwise, if  GRAPE_NUMBER_OF_JOBS>1  and the IO package is loaded,
+# then the searches for each choice of the lines through the first 
+# point are made in parallel (see  GRAPE_ParList),  and their results
+# are merged in order, so that the same spaces are returned as by a 
+# serial search.
+# 
 local ptgraph,aut,X,printlevel,I,K,s,t,deg,search,cliques,nlines,
-      ans,lines,pts,i,j,k,adj,nspaces,names;
+      ans,ansdict,setans,lines,pts,i,j,k,adj,nspaces,names,checkpoint,
+      parallel;
 ptgraph:=arg[1];
 s:=arg[2];
 t:=arg[3];
@@ -5753,13 +6884,17 @@ deg:=s*(t+1);
 if ForAny(ptgraph.adjacencies,x->Length(x)<>deg) then
    return [];
 fi;
+checkpoint:=GRAPE_CheckpointStart(["PartialLinearSpaces",ptgraph.order,
+   GeneratorsOfGroup(ptgraph.group),ptgraph.representatives,
+   ptgraph.adjacencies,s,t,nspaces]);
 aut:=AutGroupGraph(ptgraph);
 ptgraph:=NewGroupGraph(aut,ptgraph);
 if not IsBound(cliques) then
    if IsCompleteGraph(ptgraph) then
       cliques:=Combinations([1..ptgraph.order],s+1); 
    else
-      K:=CompleteSubgraphsOfGivenSize(ptgraph,s+1,true,false,true);
+      K:=CompleteSubgraphsOfGivenSize(ptgraph,s+1,true,false,true 
+            : GRAPE_checkpointing:=true);
       cliques:=Concatenation(Orbits(ptgraph.group,K,OnSets));
    fi;
    if Length(cliques) < nlines then 
@@ -5814,11 +6949,29 @@ I:=Concatenation(I,Difference([1..ptgraph.order],I));
 # It appears to be a good strategy to start  I  with the vertices 
 # of a maximal independent set of  ptgraph.
 #
-ans:=[]; 
+setans:=function(list)
+   #
+   # Sets  ans  to be the list of the distinct elements of  list  (in
+   # order),  and  ansdict  to be a dictionary for looking these up.
+   #
+   local x;
+   ans:=[];
+   ansdict:=NewDictionary([1],false);
+   for x in list do
+      if not KnowsDictionary(ansdict,x) then
+         Add(ans,x);
+         AddDictionary(ansdict,x);
+      fi;
+   od;
+end;
+setans([]);
 #
 # The "smallest" representatives of new isomorphism classes of the required
-# partial linear spaces are put in  ans  as and when they are found.
+# partial linear spaces are put in  ans  as and when they are found,
+# and are also added to the dictionary  ansdict.
 #
+parallel:=checkpoint=fail and GRAPE_NUMBER_OF_JOBS>1 
+             and IsBoundGlobal("ParListByFork");
 
 search := function ( i, sofar, live, H )
 #
@@ -5844,7 +6997,8 @@ search := function ( i, sofar, live, H )
 # It is also assumed that, on entry, the elements of  ans  are distinct
 # and are the least lexicographically in their respective  X.group-orbits. 
 # 
-local  L, K, ind, k, forbid, nlinesreq, F, pointstocover, wts, ii, jj;
+local  L, K, ind, k, forbid, nlinesreq, F, pointstocover, wts, ii, jj, kstart,
+        branches;
 if printlevel > 1 then
    Print("\ni=",i," Size(H)=",Size(H));
 fi;
@@ -5854,12 +7008,13 @@ if Length(sofar)=nlines then
    # check if its isomorphism class is new.
    #
    sofar:=SmallestImageSet(X.group,sofar);
-   if not (sofar in ans) then
+   if not KnowsDictionary(ansdict,sofar) then
       # process new isomorphism class 
       if printlevel > 1 then
          Print("\n",cliques{sofar},"\n");
       fi;     
       Add(ans,sofar);
+      AddDictionary(ansdict,sofar);
    fi;
    return;
 fi;
@@ -5903,18 +7058,47 @@ fi;
 if printlevel > 1 then    
    Print("  Length(K)=",Length(K));
 fi;    
-for k in K  do
-   L := ind.names{k};
+if i=1 and parallel then
+   # Each worker searches one choice of the lines through  I[1]  and
+   # returns the new isomorphism classes it finds. 
+   branches:=GRAPE_ParList([1..Length(K)],function(k)
+      local L;
+      setans([]);
+      L := ind.names{K[k]};
+      search( i+1, Union( sofar, L), 
+              Difference(live,Union( L, Union(List(L,x->Adjacency(X,x))) )),
+	      Stabilizer(H,L,OnSets) ); 
+      return ans;
+   end);
+   setans(Concatenation(branches));
+   if nspaces>=0 and Length(ans)>nspaces then
+      ans:=ans{[1..nspaces]};
+   fi;
+   return;
+fi;
+kstart:=1;
+if i=1 and checkpoint<>fail and checkpoint.saved<>fail 
+      and checkpoint.saved.K=K then
+   # resume an interrupted search
+   setans(checkpoint.saved.ans);
+   kstart:=checkpoint.saved.done+1;
+fi;
+for k in [kstart..Length(K)] do
+   L := ind.names{K[k]};
    forbid := Union( L, Union(List(L,x->Adjacency(X,x))) );
    search( i+1, Union( sofar, L), Difference(live,forbid),
 	   Stabilizer(H,L,OnSets) ); 
    if nspaces>=0 and Length(ans)=nspaces then
       return;
    fi;
+   if i=1 then
+      GRAPE_CheckpointSave(checkpoint,rec(K:=K,done:=k,ans:=ans));
+   fi;
 od;
 end;
 
-search(1,[],[1..X.order],X.group);   
+search(1,[],[1..X.order],X.group : GRAPE_checkpointing:=true);   
+GRAPE_CheckpointFinish(checkpoint);
 for i in [1..Length(ans)] do
    #
    # Determine the incidence graph of the partial linear space
@@ -20,10 +20,10 @@
 #
 
 BindGlobal("SmallestImageSet",function(arg)
-    local   best,  h,  k,  n,  paths,  level,  min,  goodpaths,  
+    local   best,  k,  n,  paths,  level,  min,  goodpaths,  
             orbnums,  orbmins,  gens,  path,  cands,  remset,  bestpt,  
             x,  q,  rep,  num,  pt,  gen,  img,  besto,  newpaths,  
-            cases,  case,  newpath, g, set;
+            cases,  case,  newpath, g, set, S;
     
 # Function by Steve Linton. 
 # Slightly modified by Leonard Soicher to have more parameter checking,
@@ -66,6 +66,12 @@ BindGlobal("SmallestImageSet",function(arg)
     # In the second part, we take each entry on goodpaths and see what
     # essentially different (under substab) ways there are to extend it
     # we add those to newpaths.
+    #
+    # The sequence stabilizer h is not computed as a group. Instead we
+    # keep a (copied) stabilizer chain S for h, and at each level change
+    # its base in place so that its first base point is min. Then the 
+    # transversal of S gives the elements mapping points to min, and 
+    # S.stabilizer is the stabilizer chain for the next level.
     
     if Length(arg) < 2 then
         Error("SmallestImageSet: must have at least 2 parameters");
@@ -90,7 +96,6 @@ BindGlobal("SmallestImageSet",function(arg)
         return set;
     fi;
     best := [];
-    h := g;
     if Length(arg) >= 3 then
         k := arg[3];
         if k = false then
@@ -107,12 +112,13 @@ BindGlobal("SmallestImageSet",function(arg)
     fi;
     
     n := Maximum(set[Length(set)],LargestMovedPoint(g));
+    S := CopyStabChain(StabChainMutable(g));
     paths := [rec(mappedpts := [], 
                   remainder := set, 
                   perm := (), 
                   substab := k)];
     for level in [1..Length(set)] do
-        if Size(h) = 1 then
+        if ForAll(S.generators, IsOne) then
             Append(best, Minimum(List(paths, path -> OnSets(path.remainder, path.perm))));
             return best;
         fi;
@@ -120,7 +126,7 @@ BindGlobal("SmallestImageSet",function(arg)
         goodpaths := [];
         orbnums := ListWithIdenticalEntries(n,-1);
         orbmins := [];
-        gens := GeneratorsOfGroup(h);
+        gens := S.generators;
         for path in paths do
             if Size(path.substab) = 1 then
                 cands := path.remainder;
@@ -205,6 +211,10 @@ BindGlobal("SmallestImageSet",function(arg)
             return best;
         fi;
         
+        #
+        # Make min the first base point of S
+        #
+        ChangeStabChain(S, [min], false);
         newpaths := [];
         for path in goodpaths do
             
@@ -222,16 +232,16 @@ BindGlobal("SmallestImageSet",function(arg)
                 newpath := StructuralCopy(path);
                 Add(newpath.mappedpts,case);
                 #
-                # use Representative action this way round so that the
-                # non-changing point is first. Dramatically reduces the number
-                # of base changes
-                newpath.perm  := newpath.perm / RepresentativeAction(h,min,case^path.perm);
+                # the transversal of S maps case^path.perm to min
+                #
+                newpath.perm := newpath.perm * 
+                                InverseRepresentative(S, case^path.perm);
                 RemoveSet(newpath.remainder,case);
                 newpath.substab := Stabilizer(newpath.substab,case);
                 Add(newpaths, newpath);
             od;
         od;
         paths := newpaths;
-        h := Stabilizer(h,min);
+        S := S.stabilizer;
     od;
 end);
@@ -103,6 +103,10 @@
 *       22-Jan-16 - commands with short arguments must be all on one line    *
 *                 - most errors cause rest of input line to be skipped       *
 *       19-Feb-16 - make R command induce a partition if one is defined      *
+*       18-Oct-26 - add Q command for a parallel search by parallelnauty()   *
+*       19-Oct-26 - Q also applies to Traces, using parallelTraces()         *
+*                 - add QQ command for computing invariants in parallel      *
+*                 - add invariant 17 = adaptinvar                            *
 *                                                                            *
 *****************************************************************************/
 
@@ -110,6 +114,7 @@
 #include "nautinv.h"  
 #include "schreier.h"
 #include "traces.h"
+#include "nautpar.h"
 
 #define USAGE "dreadnaut [-o options]"
 
@@ -278,7 +283,8 @@ static struct invarrec
        {adjacencies, "adjacencies", adjacencies_sg, "adjacencies_sg"},
        {cellfano,    "cellfano",    NULL,           "unavailable"},
        {cellfano2,   "cellfano2",   NULL,           "unavailable"},
-       {refinvar,    "refinvar",    NULL,           "unavailable"}
+       {refinvar,    "refinvar",    NULL,           "unavailable"},
+       {adaptinvar,  "adaptinvar",  NULL,           "unavailable"}
       };
 #define NUMINVARS ((int)(sizeof(invarproc)/sizeof(struct invarrec)))
 
@@ -293,7 +299,7 @@ static boolean options_writeautoms,options_writemarkers,
 static int options_invarproc,options_mininvarlevel,options_maxinvarlevel,
             options_invararg,options_tc_level,options_cartesian;
 static int options_schreier,options_keepgroup,options_verbosity,
-           options_strategy;
+           options_strategy,options_threads,options_invarthreads;
 
 #if USE_ANSICONTROLS && !DREADTEST
 #define PUTORBITS putorbitsplus
@@ -434,6 +440,8 @@ main(int argc, char *argv[])
     generators = NULL;
     options_verbosity = 1;
     options_strategy = 0;
+    options_threads = 1;
+    options_invarthreads = 1;
 
     n = m = 1;
     worksize = WORKSIZE;
@@ -1480,8 +1488,8 @@ main(int argc, char *argv[])
                 for (;;)
                 {
                     traces_opts.defaultptn = !pvalid;
-                    Traces(&g_sg,lab,tempptn,orbits,&traces_opts,&traces_stats,
-                       &canong_sg);
+                    parallelTraces(&g_sg,lab,tempptn,orbits,&traces_opts,
+                       &traces_stats,options_threads,&canong_sg);
                     if (traces_stats.errstatus) break;
                     traces_opts.writeautoms = FALSE;
                     traces_opts.verbosity = 0;
@@ -1606,8 +1614,8 @@ main(int argc, char *argv[])
                     setsigcatcher();
                     for (;;)
                     {
-                        nauty(g,lab,ptn,NULL,orbits,&options,&stats,workspace,
-                             2*m*worksize,m,n,canong);
+                        parallelnauty(g,lab,ptn,NULL,orbits,&options,&stats,
+                             workspace,2*m*worksize,options_threads,m,n,canong);
                         if (stats.errstatus) break;
                         options.writeautoms = FALSE;
                         options.writemarkers = FALSE;
@@ -1678,8 +1686,9 @@ main(int argc, char *argv[])
                     setsigcatcher();
                     for (;;)
                     {
-                        nauty((graph*)&g_sg,lab,ptn,NULL,orbits,&options_sg,
-                         &stats,workspace,2*m*worksize,m,n,(graph*)&canong_sg);
+                        parallelnauty((graph*)&g_sg,lab,ptn,NULL,orbits,
+                         &options_sg,&stats,workspace,2*m*worksize,
+                         options_threads,m,n,(graph*)&canong_sg);
                         if (stats.errstatus) break;
                         options_sg.writeautoms = FALSE;
                         options_sg.writemarkers = FALSE;
@@ -2237,6 +2246,31 @@ main(int argc, char *argv[])
             }
             break;
 
+        case 'Q':   /* set number of threads for nauty or invariants */
+            minus = FALSE;
+            if ((d = getc(INFILE)) != 'Q') ungetc(d,INFILE);
+            i = getint_sl(INFILE);
+            if (i < 1)
+            {
+                fprintf(ERRFILE,"number of threads must be >= 1\n");
+                FLUSHANDPROMPT;
+            }
+            else
+            {
+                if (d == 'Q')
+                {
+                    options_invarthreads = i;
+                    nautinv_threads(i);
+                }
+                else
+                    options_threads = i;
+                if (i > 1 && !parallelnauty_available())
+                    fprintf(ERRFILE,
+                     "Warning: threads need nauty configured with "
+                     "--enable-tls; using one thread\n");
+            }
+            break;
+
         case 'p':   /* set cartesian option */
             options_cartesian = !minus;
             minus = FALSE;
@@ -2334,6 +2368,10 @@ main(int argc, char *argv[])
                             options_linelength,worksize,curfile);
             if (options_schreier > 0)
                 fprintf(outfile," G=%d",options_schreier);
+            if (options_threads > 1)
+                fprintf(outfile," Q=%d",options_threads);
+            if (options_invarthreads > 1)
+                fprintf(outfile," QQ=%d",options_invarthreads);
             if (mode == TRACES_MODE)
             {
                 if (options_verbosity != 1)
@@ -2461,6 +2499,14 @@ H("Syntax for R :  R 2:4 1 5;   or  -R 0 3 6:10;")
 H("Syntax for PP :  PP 2:4 1 5 0; (must be complete)")
 H("Arguments for u : 1=node,2=autom,4=level,16=ref,32=canon (add them)")
 H("Accurate times: M=#/# set number of runs and minimum total cpu.")
+H("Q=# : number of threads for nauty and Traces, dividing the search at the")
+H("      root; the canonical labelling differs from that with one thread.")
+H("      Each vertex of the target cell starts a full search, so this only")
+H("      pays off if the target cell has little symmetry.  With Traces (At)")
+H("      it is not a speedup, and usually much slower than Q=1.")
+H("QQ=# : number of threads for computing invariants 5-15 (same results).")
+H("*=17 : adaptinvar(K): for each cell, try 8,6,15 restricted to the cell,")
+H("       cheapest first, skipping any above K million steps (default 100).")
 }
 
 }
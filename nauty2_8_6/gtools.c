@@ -1,5 +1,5 @@
 /* gtools.c : Common routines for gtools programs. */
-/* Version 4.4, Nov 2022. */
+/* Version 4.5, Oct 2026. */
 
 /* Todo: size check if MAXN>0; option to free memory */
 
@@ -32,6 +32,14 @@ extern int fseek(FILE*,long,int);
 extern FILE *popen(const char*,const char*);
 #endif
 
+#if HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+static OFF_T_VER indexedposition(char*,long,long*);
+#endif
+
 /*
   Version 1.1: Fixed sparse6 input for powers of 2.  May 9, 1998
   Version 1.2: Added "cmd: ..." option for opengraphfile(). 
@@ -59,6 +67,9 @@ extern FILE *popen(const char*,const char*);
   Version 4.2: Fixes for null graphs; thanks to Kevin Ryde.
   Version 4.4: Use fgets for gtools_getline() as it is faster except for
                  very small graphs.
+  Version 4.5: Add mapgraphfile() and friends for reading a mapped file,
+                 and side index files for random access.
+               opengraphfile() uses an existing side index to position.
 */
 
 #define B(i) (1 << ((i)-1))
@@ -87,7 +98,10 @@ opengraphfile(filename,codetype,assumefixed,position)
   position = the number of the record to position to
                 (the first is number 1; 0 and -NOLIMIT also mean
                 to position at start).  planar_code files can only
-                be positioned at the start.
+                be positioned at the start.  If the file has an
+                up-to-date side index (see mapgraphindex()) with the
+                default name, that is used to find the nearest record
+                at or before it.
 
   If the file starts with ">", there must be a header.
   Otherwise opengraphfile() fails.
@@ -298,15 +312,24 @@ opengraphfile(char *filename, int *codetype, int assumefixed, long position)
 
     if (!assumefixed || (*codetype&SPARSE6) || firstc == ':')
     {
-        l = 1;
-        while ((c = GETC(f)) != EOF)
+#if HAVE_MMAP
+        if (filename != NULL && !is_pipe
+                && (pos = indexedposition(filename,position,&l)) >= 0)
         {
-            if (c == '\n')
+            if (FSEEK_VER(f,pos,SEEK_SET) < 0)
             {
-                ++l;
-                if (l == position) break;
+                fprintf(stderr,">E opengraphfile: seek failed\n");
+                FUNLOCKFILE(f);
+                return NULL;
             }
         }
+        else
+#endif
+            l = 1;
+        while (l < position && (c = GETC(f)) != EOF)
+        {
+            if (c == '\n') ++l;
+        }
         if (l == position) return f;
 
         fprintf(stderr,
@@ -943,23 +966,14 @@ stringtograph_inc(char *s, graph *g, int m,
 
 /***********************************************************************/
 
-graph*                 /* read graph into nauty format */
-readgg(FILE *f, graph *g, int reqm, int *pm, int *pn, boolean *digraph) 
-/* graph6, digraph6 and sparse6 formats are supported 
-   f = an open file 
-   g = place to put the answer (NULL for dynamic allocation) 
-   reqm = the requested value of m (0 => compute from n) 
-   *pm = the actual value of m 
-   *pn = the value of n 
-   *digraph = whether the input is a digraph
-*/
+static graph*
+linetograph(char *s, graph *g, int reqm, int *pm, int *pn, boolean *digraph) 
+/* Check and decode the line s read by readgg() or mapreadgg(), which must
+   end with \n.  The other arguments are as for readgg(). */
 {
-    char *s,*p;
+    char *p;
     int m,n;
 
-    if ((readg_line = gtools_getline(f)) == NULL) return NULL;
-
-    s = readg_line;
     if (s[0] == ':')
     {
         readg_code = SPARSE6;
@@ -1014,6 +1028,24 @@ readgg(FILE *f, graph *g, int reqm, int *pm, int *pn, boolean *digraph)
 
 /***********************************************************************/
 
+graph*                 /* read graph into nauty format */
+readgg(FILE *f, graph *g, int reqm, int *pm, int *pn, boolean *digraph) 
+/* graph6, digraph6 and sparse6 formats are supported 
+   f = an open file 
+   g = place to put the answer (NULL for dynamic allocation) 
+   reqm = the requested value of m (0 => compute from n) 
+   *pm = the actual value of m 
+   *pn = the value of n 
+   *digraph = whether the input is a digraph
+*/
+{
+    if ((readg_line = gtools_getline(f)) == NULL) return NULL;
+
+    return linetograph(readg_line,g,reqm,pm,pn,digraph);
+}
+
+/***********************************************************************/
+
 graph*                 /* read undirected graph into nauty format */
 readg(FILE *f, graph *g, int reqm, int *pm, int *pn) 
 /* graph6 and sparse6 formats are supported 
@@ -1488,22 +1520,15 @@ stringtosparsegraph(char *s, sparsegraph *sg, int *nloops)
 
 /***********************************************************************/
 
-sparsegraph*               /* read graph into sparsegraph format */
-read_sgg_loops(FILE *f, sparsegraph *sg, int *nloops, boolean *digraph) 
-/* graph6, digraph6 and sparse6 formats are supported
- * f = an open file
- * sg = place to put the answer (NULL for dynamic allocation) 
- *      - must be initialised if not NULL 
- * nloops := number of loops (each loop in a sparse6 string
- *        gives one loop in the sparse representation)
- */
+static sparsegraph*
+linetosparsegraph(char *s, sparsegraph *sg, int *nloops, boolean *digraph) 
+/* Check and decode the line s read by read_sgg_loops() or
+   mapread_sgg_loops(), which must end with \n.  The other arguments
+   are as for read_sgg_loops(). */
 {
-    char *s,*p;
+    char *p;
     int n,loops;
 
-    if ((readg_line = gtools_getline(f)) == NULL) return NULL;
-
-    s = readg_line;
     if (s[0] == ':')
     {
         readg_code = SPARSE6;
@@ -1551,6 +1576,23 @@ read_sgg_loops(FILE *f, sparsegraph *sg, int *nloops, boolean *digraph)
 
 /***********************************************************************/
 
+sparsegraph*               /* read graph into sparsegraph format */
+read_sgg_loops(FILE *f, sparsegraph *sg, int *nloops, boolean *digraph) 
+/* graph6, digraph6 and sparse6 formats are supported
+ * f = an open file
+ * sg = place to put the answer (NULL for dynamic allocation) 
+ *      - must be initialised if not NULL 
+ * nloops := number of loops (each loop in a sparse6 string
+ *        gives one loop in the sparse representation)
+ */
+{
+    if ((readg_line = gtools_getline(f)) == NULL) return NULL;
+
+    return linetosparsegraph(readg_line,sg,nloops,digraph);
+}
+
+/***********************************************************************/
+
 sparsegraph*          /* read undirected graph into sparsegraph format */
 read_sg_loops(FILE *f, sparsegraph *sg, int *nloops) 
 /* graph6 and sparse6 formats are supported
@@ -1593,6 +1635,459 @@ read_sg(FILE *f, sparsegraph *sg)
     return sgg;
 }
 
+/*********************************************************************
+mapgraphfile(filename,codetype) maps a file of graphs into memory so
+  that mapreadgg(), mapread_sgg_loops() and mapgraphline() can read it.
+  The graphs are decoded directly from the mapping without copying.
+
+  filename = the name of the file (stdin and "cmd:" are not allowed,
+             since pipes cannot be mapped)
+  codetype = returns a code for the format, as for opengraphfile()
+
+  Only graph6, digraph6 and sparse6 files, with or without a header,
+  can be mapped.  The value returned is NULL if the file can't be
+  mapped for any reason, including that mmap() is not available.
+  In that case the caller can use opengraphfile() instead.
+
+mapgraphindex(gm,indexname) provides random access by record number
+  using a side index file, which allows a big file to be divided
+  between several processes without each of them reading it all.
+  indexname = the name of the index file (NULL means the name of the
+             graph file with GRAPHINDEX_SUFFIX appended).
+  If the index file exists and belongs to the current contents of
+  the graph file, it is mapped.  Otherwise, the index is made by one
+  pass over the mapping, written to indexname as it goes, and then
+  mapped.  The value returned is the number of graphs, or -1 on
+  failure (for example if indexname can't be written).
+
+  The index file is an array of size_t values.  The first
+  GRAPHINDEX_HEADLEN are GRAPHINDEX_MAGIC, the size and modification
+  time of the graph file, the number N of graphs and GRAPHINDEX_STEP.
+  The rest are the offsets of graphs 1, 1+GRAPHINDEX_STEP,
+  1+2*GRAPHINDEX_STEP, ... in the graph file, so the index is about
+  1/GRAPHINDEX_STEP of the size of a full one.  Index files can't be
+  moved between machines with different byte order or size_t; an
+  unsuitable one is ignored.
+
+mapseekgraph(gm,position) arranges for the next graph read from gm to
+  be number position (the first is 1; position <= 1 means the first).
+  If there is an index, this starts from the nearest offset in it and
+  skips at most GRAPHINDEX_STEP-1 lines, otherwise all the lines
+  before position are skipped.  FALSE is returned if the file has
+  fewer than position-1 graphs.
+
+**********************************************************************/
+
+#define GRAPHINDEX_MAGIC ((size_t)0x6E617574)
+#define GRAPHINDEX_HEADLEN 5
+#define GRAPHINDEX_ENTRIES(n) ((n) == 0 ? 0 : ((n)-1)/GRAPHINDEX_STEP + 1)
+
+#if HAVE_MMAP
+static size_t
+headerlen(char *p, size_t size, char *header)
+/* The length of header if p[0..size-1] starts with it, else 0 */
+{
+    size_t len;
+
+    len = strlen(header);
+    if (len > size || memcmp(p,header,len) != 0) return 0;
+    return len;
+}
+
+static boolean
+graphfileid(char *filename, size_t *id)
+/* Put the first three values of an index header for filename into
+   id[0..2].  Return FALSE if filename can't be examined. */
+{
+    struct stat st;
+
+    if (stat(filename,&st) < 0) return FALSE;
+    id[0] = GRAPHINDEX_MAGIC;
+    id[1] = (size_t)st.st_size;
+    id[2] = (size_t)st.st_mtime;
+    return TRUE;
+}
+
+static boolean
+goodindexhead(size_t *head, size_t *id)
+/* Test if head[0..GRAPHINDEX_HEADLEN-1] is the header of an index
+   for the file with graphfileid() id */
+{
+    return head[0] == id[0] && head[1] == id[1] && head[2] == id[2]
+           && head[4] == GRAPHINDEX_STEP;
+}
+
+static boolean
+mapindexfile(graphmap *gm, char *indexname, size_t *id)
+/* Map indexname into gm if it is a complete index for the file with
+   graphfileid() id.  Return whether this succeeded. */
+{
+    int fd;
+    struct stat st;
+    size_t *head;
+    void *base;
+
+    if ((fd = open(indexname,O_RDONLY)) < 0) return FALSE;
+
+    if (fstat(fd,&st) == 0 && S_ISREG(st.st_mode)
+        && (size_t)st.st_size >= GRAPHINDEX_HEADLEN*sizeof(size_t)
+        && (size_t)st.st_size % sizeof(size_t) == 0)
+    {
+        base = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0);
+        if (base != MAP_FAILED)
+        {
+            head = (size_t*)base;
+            if (goodindexhead(head,id)
+                && GRAPHINDEX_ENTRIES(head[3])
+                   == (size_t)st.st_size/sizeof(size_t) - GRAPHINDEX_HEADLEN)
+            {
+                close(fd);
+                gm->indexbase = base;
+                gm->indexsize = (size_t)st.st_size;
+                gm->index = head + GRAPHINDEX_HEADLEN;
+                gm->nindex = (long)head[3];
+                return TRUE;
+            }
+            munmap(base,(size_t)st.st_size);
+        }
+    }
+    close(fd);
+    return FALSE;
+}
+#endif
+
+graphmap*
+mapgraphfile(char *filename, int *codetype)
+{
+#if HAVE_MMAP
+    int fd;
+    size_t len;
+    struct stat st;
+    graphmap *gm;
+
+    if (filename == NULL || strcmp(filename,"-") == 0
+                         || strncmp(filename,"cmd:",4) == 0)
+        return NULL;
+
+    if ((fd = open(filename,O_RDONLY)) < 0) return NULL;
+    if (fstat(fd,&st) < 0 || !S_ISREG(st.st_mode)
+                          || (off_t)(size_t)st.st_size != st.st_size)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if ((gm = (graphmap*)ALLOCS(1,sizeof(graphmap))) == NULL)
+        gt_abort(">E mapgraphfile: malloc failed\n");
+
+    gm->size = (size_t)st.st_size;
+    if (gm->size == 0)
+        gm->base = NULL;
+    else
+    {
+        gm->base = (char*)mmap(NULL,gm->size,PROT_READ,MAP_PRIVATE,fd,0);
+        if ((void*)gm->base == MAP_FAILED)
+        {
+            close(fd);
+            FREES(gm);
+            return NULL;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(gm->base,gm->size,MADV_SEQUENTIAL);
+#endif
+    }
+    close(fd);
+
+    gm->start = 0;
+    if (gm->size == 0)
+        *codetype = GRAPH6;
+    else if (gm->base[0] != '>')
+        *codetype = gm->base[0] == ':' ? SPARSE6 
+                  : gm->base[0] == '&' ? DIGRAPH6 : GRAPH6;
+    else if ((len = headerlen(gm->base,gm->size,GRAPH6_HEADER)) > 0)
+        *codetype = GRAPH6 | HAS_HEADER;
+    else if ((len = headerlen(gm->base,gm->size,SPARSE6_HEADER)) > 0)
+        *codetype = SPARSE6 | HAS_HEADER;
+    else if ((len = headerlen(gm->base,gm->size,DIGRAPH6_HEADER)) > 0)
+        *codetype = DIGRAPH6 | HAS_HEADER;
+    else   /* other formats and bad headers are left to opengraphfile() */
+    {
+        munmap(gm->base,gm->size);
+        FREES(gm);
+        return NULL;
+    }
+    if ((*codetype & HAS_HEADER)) gm->start = len;
+
+    gm->next = gm->start;
+    gm->line = NULL;
+    gm->linelen = 0;
+    gm->nindex = -1;
+    gm->index = NULL;
+    gm->indexbase = NULL;
+    gm->indexsize = 0;
+    gm->filename = stringcopy(filename);
+
+    return gm;
+#else
+    return NULL;
+#endif
+}
+
+/*********************************************************************/
+
+void
+unmapgraphfile(graphmap *gm)
+/* Release everything belonging to gm, including gm itself */
+{
+#if HAVE_MMAP
+    if (gm->base) munmap(gm->base,gm->size);
+    if (gm->indexbase) munmap(gm->indexbase,gm->indexsize);
+#endif
+    FREES(gm->filename);
+    FREES(gm);
+}
+
+/*********************************************************************/
+
+char*
+mapgraphline(graphmap *gm)
+/* Return the next line of gm, including \n, or NULL at the end.
+   The line is usually inside the mapping, so it is not followed by \0
+   and must not be changed.  Its length is gm->linelen. */
+{
+    DYNALLSTAT(char,s,s_sz);
+    char *p,*q;
+    size_t len;
+
+    if (gm->next >= gm->size) return NULL;
+
+    p = gm->base + gm->next;
+    len = gm->size - gm->next;
+    if ((q = (char*)memchr(p,'\n',len)) != NULL)
+    {
+        len = q - p + 1;
+        gm->next += len;
+        gm->line = p;
+        gm->linelen = len;
+    }
+    else    /* last line with no \n */
+    {
+        DYNALLOC1(char,s,s_sz,len+2,"mapgraphline");
+        memcpy(s,p,len);
+        s[len] = '\n';
+        s[len+1] = '\0';
+        gm->next = gm->size;
+        gm->line = s;
+        gm->linelen = len + 1;
+    }
+
+    return gm->line;
+}
+
+/*********************************************************************/
+
+graph*
+mapreadgg(graphmap *gm, graph *g, int reqm, int *pm, int *pn,
+          boolean *digraph) 
+/* Read the next graph from gm into nauty format.  The other arguments
+   are as for readgg().  readg_line is not changed; use writemapline()
+   in place of writelast(). */
+{
+    char *s;
+
+    if ((s = mapgraphline(gm)) == NULL) return NULL;
+
+    return linetograph(s,g,reqm,pm,pn,digraph);
+}
+
+/*********************************************************************/
+
+sparsegraph*
+mapread_sgg_loops(graphmap *gm, sparsegraph *sg, int *nloops,
+                  boolean *digraph) 
+/* Read the next graph from gm into sparsegraph format.  The other
+   arguments are as for read_sgg_loops().  readg_line is not changed;
+   use writemapline() in place of writelast(). */
+{
+    char *s;
+
+    if ((s = mapgraphline(gm)) == NULL) return NULL;
+
+    return linetosparsegraph(s,sg,nloops,digraph);
+}
+
+/*********************************************************************/
+
+long
+mapgraphindex(graphmap *gm, char *indexname)
+{
+#if HAVE_MMAP
+    DYNALLSTAT(char,iname,iname_sz);
+    DYNALLSTAT(char,tname,tname_sz);
+    size_t id[3],head[GRAPHINDEX_HEADLEN];
+    size_t nidx,pos;
+    char *q;
+    FILE *f;
+    boolean ok;
+
+    if (gm->nindex >= 0) return gm->nindex;
+
+    if (indexname == NULL)
+    {
+        DYNALLOC1(char,iname,iname_sz,
+              strlen(gm->filename)+strlen(GRAPHINDEX_SUFFIX)+1,
+              "mapgraphindex");
+        strcpy(iname,gm->filename);
+        strcat(iname,GRAPHINDEX_SUFFIX);
+        indexname = iname;
+    }
+
+    if (!graphfileid(gm->filename,id) || id[1] != gm->size) return -1;
+
+    if (mapindexfile(gm,indexname,id)) return gm->nindex;
+
+    /* Write under a temporary name then rename, so that other processes
+       never see a partial index.  The count of graphs in the header is
+       filled in at the end. */
+    DYNALLOC1(char,tname,tname_sz,strlen(indexname)+30,"mapgraphindex");
+    sprintf(tname,"%s.%ld",indexname,(long)getpid());
+    if ((f = fopen(tname,"wb")) == NULL)
+    {
+        fprintf(stderr,">W mapgraphindex: can't write %s\n",indexname);
+        return -1;
+    }
+
+    head[0] = id[0];
+    head[1] = id[1];
+    head[2] = id[2];
+    head[3] = 0;
+    head[4] = GRAPHINDEX_STEP;
+    ok = fwrite(head,sizeof(size_t),GRAPHINDEX_HEADLEN,f)
+                                                == GRAPHINDEX_HEADLEN;
+
+    nidx = 0;
+    for (pos = gm->start; ok && pos < gm->size; pos = (q - gm->base) + 1)
+    {
+        if (nidx % GRAPHINDEX_STEP == 0)
+            ok = fwrite(&pos,sizeof(size_t),1,f) == 1;
+        ++nidx;
+        if ((q = (char*)memchr(gm->base+pos,'\n',gm->size-pos)) == NULL)
+            break;
+    }
+
+    head[3] = nidx;
+    ok = ok && FSEEK_VER(f,(OFF_T_VER)0,SEEK_SET) >= 0
+            && fwrite(head,sizeof(size_t),GRAPHINDEX_HEADLEN,f)
+                                                == GRAPHINDEX_HEADLEN;
+    if (fclose(f) != 0) ok = FALSE;
+    if (ok && rename(tname,indexname) != 0) ok = FALSE;
+    if (!ok)
+    {
+        remove(tname);
+        fprintf(stderr,">W mapgraphindex: can't write %s\n",indexname);
+        return -1;
+    }
+
+    return mapindexfile(gm,indexname,id) ? gm->nindex : -1;
+#else
+    return -1;
+#endif
+}
+
+/*********************************************************************/
+
+boolean
+mapseekgraph(graphmap *gm, long position)
+{
+    long l;
+    size_t pos;
+    char *q;
+
+    if (position <= 1)
+    {
+        gm->next = gm->start;
+        return TRUE;
+    }
+
+    if (gm->nindex >= 0)
+    {
+        if (position > gm->nindex + 1) return FALSE;
+        if (position == gm->nindex + 1)
+        {
+            gm->next = gm->size;
+            return TRUE;
+        }
+        l = ((position-1) / GRAPHINDEX_STEP) * GRAPHINDEX_STEP + 1;
+        pos = gm->index[(position-1) / GRAPHINDEX_STEP];
+    }
+    else
+    {
+        l = 1;
+        pos = gm->start;
+    }
+
+    for ( ; l < position; ++l)
+    {
+        if (pos >= gm->size) return FALSE;
+        q = (char*)memchr(gm->base+pos,'\n',gm->size-pos);
+        pos = (q == NULL ? gm->size : (size_t)(q - gm->base) + 1);
+    }
+    gm->next = pos;
+    return TRUE;
+}
+
+/*********************************************************************/
+
+void
+writemapline(FILE *f, graphmap *gm)
+/* write the last graph read from gm, like writelast() does for readg() */
+{
+    if (fwrite(gm->line,1,gm->linelen,f) != gm->linelen || ferror(f))
+        gt_abort(">E writemapline : error on writing\n");
+}
+
+#if HAVE_MMAP
+static OFF_T_VER
+indexedposition(char *filename, long position, long *line)
+/* If filename has an up-to-date side index with default name, return
+   the offset of the nearest indexed graph at or before number position
+   and put its number into *line, else return -1. */
+{
+    DYNALLSTAT(char,iname,iname_sz);
+    FILE *f;
+    size_t id[3],head[GRAPHINDEX_HEADLEN],off;
+    size_t k;
+    boolean ok;
+
+    if (!graphfileid(filename,id)) return -1;
+
+    DYNALLOC1(char,iname,iname_sz,
+              strlen(filename)+strlen(GRAPHINDEX_SUFFIX)+1,"opengraphfile");
+    strcpy(iname,filename);
+    strcat(iname,GRAPHINDEX_SUFFIX);
+    if ((f = fopen(iname,"rb")) == NULL) return -1;
+
+    ok = fread(head,sizeof(size_t),GRAPHINDEX_HEADLEN,f) == GRAPHINDEX_HEADLEN
+         && goodindexhead(head,id) && (size_t)position <= head[3] + 1;
+    if (ok && (size_t)position == head[3] + 1)
+    {
+        off = id[1];
+        *line = position;
+    }
+    else if (ok)
+    {
+        k = (size_t)(position-1) / GRAPHINDEX_STEP;
+        ok = FSEEK_VER(f,(OFF_T_VER)((GRAPHINDEX_HEADLEN+k)
+                                      *sizeof(size_t)),SEEK_SET) >= 0
+             && fread(&off,sizeof(size_t),1,f) == 1;
+        *line = (long)(k * GRAPHINDEX_STEP + 1);
+    }
+    fclose(f);
+
+    return ok ? (OFF_T_VER)off : -1;
+}
+#endif
+
 /****************************************************************************/
 
 DYNALLSTAT(char,gcode,gcode_sz);  /* Used by ntog6, ntos6, ntod6 and sgtos6 */
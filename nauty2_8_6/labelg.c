@@ -1,7 +1,7 @@
 /* labelg.c version 2.0; B D McKay, Jun 2015 */
 
 #define USAGE "labelg [-q] [-sgz | -C#W#] [-fxxx] [-S|-t] \n\
-                          [-i# -I#:# -K#] [infile [outfile]]"
+                          [-i# -I#:# -K#] [-p#:#] [infile [outfile]]"
 
 #define HELPTEXT \
 " Canonically label a file of graphs or digraphs.\n\
@@ -27,6 +27,13 @@
         in their original labelling.  Don't write the table.\n\
 \n\
     The output file will have a header if and only if the input file does.\n\
+\n\
+    -p# -p#:#  Only process input graphs in this range (first is 1).\n\
+        If infile is a file that can be mapped into memory, a side index\n\
+        infile.gidx is made or reused, so that the start of the range is\n\
+        found after skipping at most 1023 earlier graphs.  This allows a\n\
+        big file to be divided between several processes.  Countg and\n\
+        pickg -p also use the index when it exists.\n\
 \n\
     -fxxx  Specify a partition of the point set.  xxx is any\n\
         string of ASCII characters except nul.  This string is\n\
@@ -105,14 +112,15 @@ main(int argc, char *argv[])
     boolean sswitch,gswitch,qswitch,fswitch,Oswitch;
     boolean iswitch,Iswitch,Kswitch,Mswitch,Sswitch;
     boolean uswitch,tswitch,Cswitch,Wswitch,zswitch;
-    boolean dooutput;
+    boolean dooutput,pswitch;
     int tabsize,outinvar;
     int inv,mininvarlevel,maxinvarlevel,invararg;
-    long minil,maxil;
+    long minil,maxil,pval1,pval2;
     double t;
     char *infilename,*outfilename;
     FILE *infile,*outfile;
-    nauty_counter nin,nout;
+    graphmap *gm;
+    nauty_counter nin,nout,maxin;
     int ii,secret,loops;
     DEFAULTOPTIONS_TRACES(traces_opts);
     TracesStats traces_stats;
@@ -135,7 +143,7 @@ main(int argc, char *argv[])
     fswitch = Oswitch = Mswitch = FALSE;
     iswitch = Iswitch = Kswitch = FALSE;
     uswitch = Sswitch = tswitch = FALSE;
-    zswitch = Cswitch = Wswitch = FALSE;
+    zswitch = Cswitch = Wswitch = pswitch = FALSE;
     infilename = outfilename = NULL;
     inv = 0;
 
@@ -164,6 +172,7 @@ main(int argc, char *argv[])
                 else SWINT('K',Kswitch,invararg,"labelg -K")
                 else SWRANGE('k',":-",Iswitch,minil,maxil,"labelg -k")
                 else SWRANGE('I',":-",Iswitch,minil,maxil,"labelg -I")
+                else SWRANGE('p',":-",pswitch,pval1,pval2,"labelg -p")
                 else if (sw == 'f')
                 {
                     fswitch = TRUE;
@@ -231,7 +240,7 @@ main(int argc, char *argv[])
     {
         fprintf(stderr,">A labelg");
         if (sswitch || gswitch || fswitch || iswitch || zswitch
-                    || tswitch || Sswitch || Cswitch || Wswitch)
+                    || tswitch || Sswitch || Cswitch || Wswitch || pswitch)
             fprintf(stderr," -");
         if (sswitch) fprintf(stderr,"s");
         if (gswitch) fprintf(stderr,"g");
@@ -240,6 +249,7 @@ main(int argc, char *argv[])
         if (tswitch) fprintf(stderr,"t");
         if (Cswitch) fprintf(stderr,"C%d",tabsize);
         if (Wswitch) fprintf(stderr,"W%d",outinvar);
+        if (pswitch) writerange(stderr,'p',pval1,pval2);
         if (iswitch)
             fprintf(stderr,"i=%s[%d:%d,%d]",invarproc[inv].name,
                     mininvarlevel,maxinvarlevel,invararg);
@@ -257,11 +267,33 @@ main(int argc, char *argv[])
     }
 
     if (infilename && infilename[0] == '-') infilename = NULL;
-    infile = opengraphfile(infilename,&codetype,FALSE,1);
-
-    if (!infile) exit(1);
+    infile = NULL;
+    if ((gm = mapgraphfile(infilename,&codetype)) != NULL)
+    {
+        if (pswitch && pval1 > 1)
+        {
+            mapgraphindex(gm,NULL);
+            if (!mapseekgraph(gm,pval1))
+            {
+                fprintf(stderr,">E labelg: can't find graph %ld in %s\n",
+                        pval1,infilename);
+                exit(1);
+            }
+        }
+    }
+    else
+    {
+        infile = opengraphfile(infilename,&codetype,FALSE,
+                               pswitch ? pval1 : 1);
+        if (!infile) exit(1);
+    }
     if (!infilename) infilename = "stdin";
 
+    if (!pswitch || pval2 == NOLIMIT) maxin = NOLIMIT;
+    else if (pval2 < 1 || pval2 < pval1) maxin = 0;
+    else if (pval1 < 1)               maxin = pval2;
+    else                              maxin = pval2 - pval1 + 1;
+
     if (!outfilename || outfilename[0] == '-')
     {
         outfilename = "stdout";
@@ -319,7 +351,10 @@ main(int argc, char *argv[])
         SG_INIT(sh);
         while (TRUE)
         {
-            if (read_sgg_loops(infile,&sg,&loops,&digraph) == NULL) break;
+            if (nin >= maxin) break;
+            if ((gm ? mapread_sgg_loops(gm,&sg,&loops,&digraph)
+                    : read_sgg_loops(infile,&sg,&loops,&digraph)) == NULL)
+                break;
             ++nin;
             n = sg.nv;
             m = (n + WORDSIZE - 1) / WORDSIZE;
@@ -340,7 +375,8 @@ main(int argc, char *argv[])
                 ++tab[hashgraph_sg(&sh,137)%tabsize];
             else if (outcode == -2 && (hashgraph_sg(&sh,137)%tabsize) == outinvar)
             {
-                writelast(outfile);
+                if (gm) writemapline(outfile,gm);
+                else    writelast(outfile);
                 ++nout;
             }
         }
@@ -356,7 +392,10 @@ main(int argc, char *argv[])
         
         while (TRUE)
         {
-            if (read_sgg_loops(infile,&sg,&loops,&digraph) == NULL) break;
+            if (nin >= maxin) break;
+            if ((gm ? mapread_sgg_loops(gm,&sg,&loops,&digraph)
+                    : read_sgg_loops(infile,&sg,&loops,&digraph)) == NULL)
+                break;
             if (loops > 0 || digraph)
                 gt_abort(">E Traces does not allow loops or directed edges\n");
             ++nin;
@@ -383,7 +422,8 @@ main(int argc, char *argv[])
                 ++tab[hashgraph_sg(&sh,137)%tabsize];
             else if (outcode == -2 && (hashgraph_sg(&sh,137)%tabsize) == outinvar)
             {
-                writelast(outfile);
+                if (gm) writemapline(outfile,gm);
+                else    writelast(outfile);
                 ++nout;
             }
             SG_FREE(sh);
@@ -393,7 +433,10 @@ main(int argc, char *argv[])
     {
         while (TRUE)
         {
-            if ((g = readgg(infile,NULL,0,&m,&n,&digraph)) == NULL) break;
+            if (nin >= maxin) break;
+            if ((g = (gm ? mapreadgg(gm,NULL,0,&m,&n,&digraph)
+                         : readgg(infile,NULL,0,&m,&n,&digraph))) == NULL)
+                break;
             ++nin;
 #if !MAXN
             DYNALLOC2(graph,h,h_sz,n,m,"labelg");
@@ -414,13 +457,15 @@ main(int argc, char *argv[])
                 ++tab[hashgraph(h,m,n,137)%tabsize];
             else if (outcode == -2 && (hashgraph(h,m,n,137)%tabsize) == outinvar)
             {
-                writelast(outfile);
+                if (gm) writemapline(outfile,gm);
+                else    writelast(outfile);
                 ++nout;
             }
             FREES(g);
         }
     }
     t = CPUTIME - t;
+    if (gm) unmapgraphfile(gm);
 
     if (Oswitch)
         fprintf(stderr,">C orbit totals = " COUNTER_FMT " %15.8f\n",
@@ -19,6 +19,11 @@
 *       23-Jan-13 : add some parens to make icc happy                        *
 *       15-Oct-19 : fix default size of dnwork[] to match densenauty()       *
 *        6-Apr-21 : increase work space in densenauty()                      *
+*       19-Oct-26 : AVX2 and AVX-512 kernels for refine(), chosen at run     *
+*                   time                                                     *
+*                 : mark the refinement and labelling procedures with        *
+*                   NAUTY_HOT                                                *
+*                 : initialise maxpos in refine() and refine1()              *
 *                                                                            *
 *****************************************************************************/
 
@@ -46,6 +51,22 @@ dispatchvec dispatch_graph =
   {isautom,testcanlab,updatecan,refine,refine1,cheapautom,targetcell,
    naugraph_freedyn,naugraph_check,NULL,NULL};
 
+/* On x86-64 with gcc or clang, refine() counts the neighbours of a vertex
+   in the splitting cell using AVX2 or AVX-512 instructions if the CPU
+   supports them, even if nauty was compiled for a generic target.
+   Define NAUTY_NO_SIMD to prevent this. */
+
+#if MAXM!=1 && WORDSIZE==64 && defined(__x86_64__) \
+    && !defined(NAUTY_NO_SIMD) && ((defined(__clang__) && __clang_major__ >= 10) \
+        || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define SIMDREFINE 1
+#include <immintrin.h>
+#define SIMDMINM 4     /* smallest m for which the kernels are used */
+static TLS_ATTR int (*rowcount)(set*,set*,int) = NULL;
+#else
+#define SIMDREFINE 0
+#endif
+
 #if !MAXN
 DYNALLSTAT(set,workset,workset_sz);
 DYNALLSTAT(int,workperm,workperm_sz);
@@ -65,6 +86,7 @@ static TLS_ATTR set dnwork[2*500*MAXM];
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 boolean
 isautom(graph *g, int *perm, boolean digraph, int m, int n)
 {
@@ -98,6 +120,7 @@ isautom(graph *g, int *perm, boolean digraph, int m, int n)
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 int
 testcanlab(graph *g, graph *canong, int *lab, int *samerows, int m, int n)
 {
@@ -140,6 +163,7 @@ testcanlab(graph *g, graph *canong, int *lab, int *samerows, int m, int n)
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 void
 updatecan(graph *g, graph *canong, int *lab, int samerows, int m, int n)
 {
@@ -157,6 +181,110 @@ updatecan(graph *g, graph *canong, int *lab, int samerows, int m, int n)
         permset(GRAPHROW(g,lab[i],M),ph,M,workperm);
 }
 
+#if SIMDREFINE
+/*****************************************************************************
+*                                                                            *
+*  rowcount_*(s1,s2,m) = the size of the intersection of the sets s1 and     *
+*  s2, using the instruction set in the name.  chooserowcount() returns the  *
+*  best one that the CPU supports.                                           *
+*                                                                            *
+*****************************************************************************/
+
+static int
+rowcount_generic(set *s1, set *s2, int m)
+{
+    int i,cnt;
+    setword x;
+
+    cnt = 0;
+    for (i = 0; i < m; ++i)
+        if ((x = s1[i] & s2[i]) != 0) cnt += POPCOUNT(x);
+
+    return cnt;
+}
+
+__attribute__((target("avx2,popcnt")))
+static int
+rowcount_avx2(set *s1, set *s2, int m)
+{
+    /* popcount of each nibble by table lookup, summed by _mm256_sad_epu8 */
+    const __m256i nibblecount = _mm256_setr_epi8(
+                   0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                   0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i lownibbles = _mm256_set1_epi8(0x0f);
+    __m256i x,c,acc;
+    int i,cnt;
+
+    acc = _mm256_setzero_si256();
+    for (i = 0; i + 4 <= m; i += 4)
+    {
+        x = _mm256_and_si256(_mm256_loadu_si256((__m256i*)(s1+i)),
+                             _mm256_loadu_si256((__m256i*)(s2+i)));
+        c = _mm256_add_epi8(
+              _mm256_shuffle_epi8(nibblecount,
+                                  _mm256_and_si256(x,lownibbles)),
+              _mm256_shuffle_epi8(nibblecount,
+                  _mm256_and_si256(_mm256_srli_epi16(x,4),lownibbles)));
+        acc = _mm256_add_epi64(acc,_mm256_sad_epu8(c,_mm256_setzero_si256()));
+    }
+
+    cnt = (int)(_mm256_extract_epi64(acc,0) + _mm256_extract_epi64(acc,1)
+              + _mm256_extract_epi64(acc,2) + _mm256_extract_epi64(acc,3));
+    for ( ; i < m; ++i) cnt += __builtin_popcountll(s1[i] & s2[i]);
+
+    return cnt;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static int
+rowcount_avx512(set *s1, set *s2, int m)
+{
+    __m512i acc,x;
+    __mmask8 k;
+    int i;
+
+    acc = _mm512_setzero_si512();
+    for (i = 0; i + 8 <= m; i += 8)
+    {
+        x = _mm512_and_si512(_mm512_loadu_si512((void*)(s1+i)),
+                             _mm512_loadu_si512((void*)(s2+i)));
+        acc = _mm512_add_epi64(acc,_mm512_popcnt_epi64(x));
+    }
+    if (i < m)
+    {
+        k = (__mmask8)((1U << (m-i)) - 1);
+        x = _mm512_and_si512(_mm512_maskz_loadu_epi64(k,(void*)(s1+i)),
+                             _mm512_maskz_loadu_epi64(k,(void*)(s2+i)));
+        acc = _mm512_add_epi64(acc,_mm512_popcnt_epi64(x));
+    }
+
+    return (int)_mm512_reduce_add_epi64(acc);
+}
+
+static int
+(*chooserowcount(void))(set*,set*,int)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vpopcntdq")) return rowcount_avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        return rowcount_avx2;
+    return rowcount_generic;
+}
+
+    /* COUNTROW(cnt,row) sets cnt to the size of the intersection of
+       workset and row; it uses c1, x, set1 and set2 as work variables. */
+#define COUNTROW(cnt,row) \
+    if (m >= SIMDMINM) cnt = (*rowcount)(workset,row,m); \
+    else { set1 = workset; set2 = row; cnt = 0; \
+       for (c1 = m; --c1 >= 0;) \
+          if ((x = ((*set1++) & (*set2++))) != 0) cnt += POPCOUNT(x); }
+#else
+#define COUNTROW(cnt,row) \
+    { set1 = workset; set2 = row; cnt = 0; \
+       for (c1 = m; --c1 >= 0;) \
+          if ((x = ((*set1++) & (*set2++))) != 0) cnt += POPCOUNT(x); }
+#endif
+
 /*****************************************************************************
 *                                                                            *
 *  refine(g,lab,ptn,level,numcells,count,active,code,m,n) performs a         *
@@ -175,6 +303,7 @@ updatecan(graph *g, graph *canong, int *lab, int samerows, int m, int n)
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 void
 refine(graph *g, int *lab, int *ptn, int level, int *numcells,
        int *count, set *active, int *code, int m, int n)
@@ -192,13 +321,16 @@ refine(graph *g, int *lab, int *ptn, int level, int *numcells,
     int cnt,bmin,bmax;
     long longcode;
     set *gptr;
-    int maxcell,maxpos,hint;
+    int maxcell,maxpos = 0,hint;
 
 #if !MAXN
     DYNALLOC1(int,workperm,workperm_sz,n,"refine");
     DYNALLOC1(set,workset,workset_sz,m,"refine");
     DYNALLOC1(int,bucket,bucket_sz,n+2,"refine");
 #endif
+#if SIMDREFINE
+    if (rowcount == NULL) rowcount = chooserowcount();
+#endif
 
     longcode = *numcells;
     split1 = -1;
@@ -262,23 +394,13 @@ refine(graph *g, int *lab, int *ptn, int level, int *numcells,
                 for (cell2 = cell1; ptn[cell2] > level; ++cell2) {}
                 if (cell1 == cell2) continue;
                 i = cell1;
-                set1 = workset;
-                set2 = GRAPHROW(g,lab[i],m);
-                cnt = 0;
-                for (c1 = m; --c1 >= 0;)
-                    if ((x = ((*set1++) & (*set2++))) != 0)
-                        cnt += POPCOUNT(x);
+                COUNTROW(cnt,GRAPHROW(g,lab[i],m));
 
                 count[i] = bmin = bmax = cnt;
                 bucket[cnt] = 1;
                 while (++i <= cell2)
                 {
-                    set1 = workset;
-                    set2 = GRAPHROW(g,lab[i],m);
-                    cnt = 0;
-                    for (c1 = m; --c1 >= 0;)
-                        if ((x = ((*set1++) & (*set2++))) != 0)
-                            cnt += POPCOUNT(x);
+                    COUNTROW(cnt,GRAPHROW(g,lab[i],m));
 
                     while (bmin > cnt) bucket[--bmin] = 0;
                     while (bmax < cnt) bucket[++bmax] = 0;
@@ -338,6 +460,7 @@ refine(graph *g, int *lab, int *ptn, int level, int *numcells,
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 void
 refine1(graph *g, int *lab, int *ptn, int level, int *numcells,
        int *count, set *active, int *code, int m, int n)
@@ -348,7 +471,7 @@ refine1(graph *g, int *lab, int *ptn, int level, int *numcells,
     int cnt,bmin,bmax;
     long longcode;
     set *gptr,workset0;
-    int maxcell,maxpos,hint;
+    int maxcell,maxpos = 0,hint;
 
 #if !MAXN 
     DYNALLOC1(int,workperm,workperm_sz,n,"refine1"); 
@@ -525,6 +648,7 @@ cheapautom(int *ptn, int level, boolean digraph, int n)
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 static int
 bestcell(const graph *g, const int *lab, const int *ptn, int level,
          int tc_level, int m, int n)
@@ -59,6 +59,7 @@
 *       18-Jan-12 : changes for version 2.6 :                                *
 *                 - declare nauty_kill_request                               *
 *        8-May-20 : add const declarations to prototypes                     *
+*       19-Oct-26 : mark fmperm(), fmptn() and longprune() with NAUTY_HOT    *
 *                                                                            *
 *****************************************************************************/
 
@@ -375,6 +376,7 @@ writeperm(FILE *f, const int *perm, boolean cartesian, int linelength, int n)
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 void
 fmperm(const int *perm, set *fix, set *mcr, int m, int n)
 {
@@ -421,6 +423,7 @@ fmperm(const int *perm, set *fix, set *mcr, int m, int n)
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 void
 fmptn(const int *lab, const int *ptn, int level, set *fix, set *mcr, int m, int n)
 {
@@ -643,6 +646,7 @@ breakout(int *lab, int *ptn, int level, int tc, int tv,
 *                                                                            *
 *****************************************************************************/
 
+NAUTY_HOT
 void
 longprune(set *tcell, set *fix, set *bottom, set *top, int m)
 {
@@ -38,6 +38,9 @@
 *       15-Jan-12 : add TLS_ATTR attributes                                  *
 *       23-Aug-12 : fix getbigcells(), thanks to Fatih Demirkale             *
 *       23-Jan-13 : add some parens to satisfy icc                           *
+*       19-Oct-26 : add nautinv_threads() and compute the expensive          *
+*                   invariants in several threads if requested               *
+*                 - add adaptinvar()                                         *
 *                                                                            *
 *****************************************************************************/
 
@@ -69,6 +72,17 @@ static const int fuzz2[] = {006532,070236,035523,062437};
 
 #define MAXCLIQUE 10    /* max clique size for cliques() and maxindset() */
 
+#if HAVE_TLS && !MAXN
+#include <pthread.h>
+#define PARALLEL_OK 1
+#else
+#define PARALLEL_OK 0
+#endif
+
+#define PARINVARWORK 1e6   /* least estimated work for using threads */
+
+static TLS_ATTR int invarthreads = 1;
+
 #if MAXN
 static TLS_ATTR int workshort[MAXN+2];
 static TLS_ATTR int vv[MAXN],ww[MAXN];
@@ -176,6 +190,162 @@ DYNALLSTAT(set,wss,wss_sz);
 *                                                                            *
 *****************************************************************************/
 
+/*****************************************************************************
+*                                                                            *
+*  The expensive invariants are written as a loop whose body is a separate   *
+*  procedure step(job,inv,i), which does the work for outer index i and      *
+*  accumulates the answer in inv[].  runinvarjob() does the steps for        *
+*  i = first..last, either itself or by dividing the values of i between     *
+*  nautinv_threads() threads.  In the latter case each thread accumulates    *
+*  into its own array, and the arrays are added together at the end using    *
+*  ACCUM (or ordinary addition for invariants that count), so the answer is  *
+*  the same as with one thread.  The threads are only used if nauty was      *
+*  configured with --enable-tls, since the steps use the TLS work arrays.    *
+*                                                                            *
+*****************************************************************************/
+
+typedef struct invarjobstruct
+{
+    void (*step)(struct invarjobstruct*,int*,int);
+    graph *g;
+    int *lab;
+    int *weight;               /* vertex weights, if used */
+    set *cellset;              /* the vertices of the cell, if used */
+    int cell1,cell2;           /* the current cell, if used */
+    int setsize;               /* size of sets, or distance limit */
+    int m,n;
+#if PARALLEL_OK
+    int next,last,chunk;       /* the next and last values of i to do */
+    pthread_mutex_t mutex;
+#endif
+} invarjob;
+
+#if PARALLEL_OK
+typedef struct
+{
+    invarjob *job;
+    int *inv;                  /* where this thread accumulates */
+} invarpart;
+
+static void
+invarworker(invarpart *ip)
+{
+    invarjob *job;
+    int i,ilim;
+
+    job = ip->job;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->mutex);
+        i = job->next;
+        job->next += job->chunk;
+        pthread_mutex_unlock(&job->mutex);
+        if (i > job->last) break;
+
+        ilim = i + job->chunk - 1;
+        if (ilim > job->last) ilim = job->last;
+        for (; i <= ilim; ++i) (*job->step)(job,ip->inv,i);
+    }
+}
+
+static void*
+invarthread(void *arg)
+{
+    invarworker((invarpart*)arg);
+    nautinv_freedyn();
+    return NULL;
+}
+#endif
+
+static void
+runinvarjob(invarjob *job, int *invar, int first, int last,
+            double work, boolean counting)
+/* Do job->step for i = first..last, accumulating in invar[].  work is
+   an estimate of the number of operations needed. */
+{
+    int i;
+#if PARALLEL_OK
+    int j,n,nt,numstarted;
+    int *parts;
+    invarpart *ip;
+    pthread_t *threads;
+
+    nt = invarthreads;
+    if (nt > last - first + 1) nt = last - first + 1;
+
+    if (nt > 1 && work >= PARINVARWORK)
+    {
+        n = job->n;
+        parts = (int*)ALLOCS((size_t)(nt-1)*n,sizeof(int));
+        ip = (invarpart*)ALLOCS(nt,sizeof(invarpart));
+        threads = (pthread_t*)ALLOCS(nt,sizeof(pthread_t));
+        if (parts == NULL || ip == NULL || threads == NULL)
+            alloc_error("runinvarjob");
+
+        job->next = first;
+        job->last = last;
+        job->chunk = (last - first + 1) / (16*nt);
+        if (job->chunk < 1) job->chunk = 1;
+        pthread_mutex_init(&job->mutex,NULL);
+
+        ip[0].job = job;
+        ip[0].inv = invar;
+        for (j = 1; j < nt; ++j)
+        {
+            ip[j].job = job;
+            ip[j].inv = parts + (size_t)(j-1)*n;
+            for (i = 0; i < n; ++i) ip[j].inv[i] = 0;
+        }
+
+        for (numstarted = 0; numstarted < nt-1; ++numstarted)
+            if (pthread_create(&threads[numstarted],NULL,
+                               invarthread,&ip[numstarted+1]) != 0)
+                break;
+        invarworker(&ip[0]);
+        for (j = 0; j < numstarted; ++j) pthread_join(threads[j],NULL);
+        pthread_mutex_destroy(&job->mutex);
+
+        for (j = 1; j <= numstarted; ++j)
+        {
+            if (counting)
+                for (i = 0; i < n; ++i) invar[i] += ip[j].inv[i];
+            else
+                for (i = 0; i < n; ++i) ACCUM(invar[i],ip[j].inv[i]);
+        }
+
+        FREES(threads);
+        FREES(ip);
+        FREES(parts);
+        return;
+    }
+#endif
+
+    for (i = first; i <= last; ++i) (*job->step)(job,invar,i);
+}
+
+/*****************************************************************************
+*                                                                            *
+*  nautinv_threads(nthreads) sets the number of threads used by the          *
+*  invariants celltrips(), cellquads(), cellquins(), cellfano(),             *
+*  cellfano2(), distances(), indsets(), cliques(), cellcliq(), cellind()     *
+*  and adjacencies(), and returns the previous setting.  A value less than   *
+*  1 is taken as 1.  The setting only applies to calls in the same thread,   *
+*  and more than one thread is only used if nauty was configured with        *
+*  --enable-tls and the Posix threads library is linked.                     *
+*                                                                            *
+*****************************************************************************/
+
+int
+nautinv_threads(int nthreads)
+{
+    int prev;
+
+    prev = invarthreads;
+    invarthreads = (nthreads < 1 ? 1 : nthreads);
+
+    return prev;
+}
+
 /*****************************************************************************
 *                                                                            *
 *  twopaths() assigns to each vertex v the sum of the weights of each vertex *
@@ -504,21 +674,63 @@ getbigcells(int *ptn, int level, int minsize, int *bigcells,
 *                                                                            *
 *****************************************************************************/
 
-void
-celltrips(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-          int *invar, int invararg, boolean digraph, int m, int n)
+static void
+celltrips_step(invarjob *job, int *invar, int iv)
+/* The triples {v,v1,v2} in the current cell with v = lab[iv] first */
 {
     int i,pc;
     setword sw;
     set *gw;
     int wt;
-    int v,iv,v1,iv1,v2,iv2;
-    int icell,bigcells,cell1,cell2;
-    int *cellstart,*cellsize;
+    int v,v1,iv1,v2,iv2;
+    int cell2,m;
+    graph *g;
+    int *lab;
     set *gv;
 
+    g = job->g;
+    lab = job->lab;
+    cell2 = job->cell2;
+    m = job->m;
 #if !MAXN
     DYNALLOC1(set,workset,workset_sz,m,"celltrips");
+#endif
+
+    v = lab[iv];
+    gv = GRAPHROW(g,v,m);
+    for (iv1 = iv + 1; iv1 <= cell2 - 1; ++iv1)
+    {
+        v1 = lab[iv1];
+        gw = GRAPHROW(g,v1,m);
+        for (i = M; --i >= 0;) workset[i] = gv[i] ^ gw[i];
+        for (iv2 = iv1 + 1; iv2 <= cell2; ++iv2)
+        {
+            v2 = lab[iv2];
+            gw = GRAPHROW(g,v2,m);
+            pc = 0;
+            for (i = M; --i >= 0;)
+                if ((sw = workset[i] ^ gw[i]) != 0)
+                    pc += POPCOUNT(sw);
+            wt = FUZZ1(pc);
+            ACCUM(invar[v],wt);
+            ACCUM(invar[v1],wt);
+            ACCUM(invar[v2],wt);
+        }
+    }
+}
+
+void
+celltrips(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+          int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    int icell,bigcells,cell1,cell2;
+    int *cellstart,*cellsize;
+    double sz;
+    invarjob job;
+
+#if !MAXN
     DYNALLOC1(int,workshort,workshort_sz,n+2,"celltrips");
 #endif
 
@@ -528,34 +740,20 @@ celltrips(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
     cellsize = workshort + (n/2);
     getbigcells(ptn,level,3,&bigcells,cellstart,cellsize,n);
 
+    job.step = celltrips_step;
+    job.g = g;
+    job.lab = lab;
+    job.m = m;
+    job.n = n;
+
     for (icell = 0; icell < bigcells; ++icell)
     {
         cell1 = cellstart[icell];
         cell2 = cell1 + cellsize[icell] - 1;
-        for (iv = cell1; iv <= cell2 - 2; ++iv)
-        {
-            v = lab[iv];
-            gv = GRAPHROW(g,v,m);
-            for (iv1 = iv + 1; iv1 <= cell2 - 1; ++iv1)
-            {
-                v1 = lab[iv1];
-                gw = GRAPHROW(g,v1,m);
-                for (i = M; --i >= 0;) workset[i] = gv[i] ^ gw[i];
-                for (iv2 = iv1 + 1; iv2 <= cell2; ++iv2)
-                {
-                    v2 = lab[iv2];
-                    gw = GRAPHROW(g,v2,m);
-                    pc = 0;
-                    for (i = M; --i >= 0;)
-                        if ((sw = workset[i] ^ gw[i]) != 0)
-                            pc += POPCOUNT(sw);
-                    wt = FUZZ1(pc);
-                    ACCUM(invar[v],wt);
-                    ACCUM(invar[v1],wt);
-                    ACCUM(invar[v2],wt);
-                }
-            }
-        }
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2-2,sz*sz*sz/6.0*m,FALSE);
         wt = invar[lab[cell1]];
         for (i = cell1 + 1; i <= cell2; ++i)
             if (invar[lab[i]] != wt) return;
@@ -572,66 +770,94 @@ celltrips(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
-void
-cellquads(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-          int *invar, int invararg, boolean digraph, int m, int n)
+static void
+cellquads_step(invarjob *job, int *invar, int iv)
+/* The 4-tuples {v,v1,v2,v3} in the current cell with v = lab[iv] first */
 {
     int i,pc;
     setword sw;
     set *gw;
     int wt;
-    int v,iv,v1,iv1,v2,iv2,v3,iv3;
-    int icell,bigcells,cell1,cell2;
-    int *cellstart,*cellsize;
+    int v,v1,iv1,v2,iv2,v3,iv3;
+    int cell2,m;
+    graph *g;
+    int *lab;
     set *gv;
 
+    g = job->g;
+    lab = job->lab;
+    cell2 = job->cell2;
+    m = job->m;
 #if !MAXN
     DYNALLOC1(set,workset,workset_sz,m,"cellquads");
-    DYNALLOC1(int,workshort,workshort_sz,n+2,"cellquads");
     DYNALLOC1(set,ws1,ws1_sz,m,"cellquads");
 #endif
 
+    v = lab[iv];
+    gv = GRAPHROW(g,v,m);
+    for (iv1 = iv + 1; iv1 <= cell2 - 2; ++iv1)
+    {
+        v1 = lab[iv1];
+        gw = GRAPHROW(g,v1,m);
+        for (i = M; --i >= 0;) workset[i] = gv[i] ^ gw[i];
+        for (iv2 = iv1 + 1; iv2 <= cell2 - 1; ++iv2)
+        {
+            v2 = lab[iv2];
+            gw = GRAPHROW(g,v2,m);
+            for (i = M; --i >= 0;) ws1[i] = workset[i] ^ gw[i];
+            for (iv3 = iv2 + 1; iv3 <= cell2; ++iv3)
+            {
+                v3 = lab[iv3];
+                gw = GRAPHROW(g,v3,m);
+                pc = 0;
+                for (i = M; --i >= 0;)
+                    if ((sw = ws1[i] ^ gw[i]) != 0)
+                        pc += POPCOUNT(sw);
+                wt = FUZZ1(pc);
+                ACCUM(invar[v],wt);
+                ACCUM(invar[v1],wt);
+                ACCUM(invar[v2],wt);
+                ACCUM(invar[v3],wt);
+            }
+        }
+    }
+}
+
+void
+cellquads(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+          int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    int icell,bigcells,cell1,cell2;
+    int *cellstart,*cellsize;
+    double sz;
+    invarjob job;
+
+#if !MAXN
+    DYNALLOC1(int,workshort,workshort_sz,n+2,"cellquads");
+#endif
+
     for (i = n; --i >= 0;) invar[i] = 0;
 
     cellstart = workshort;
     cellsize = workshort + (n/2);
     getbigcells(ptn,level,4,&bigcells,cellstart,cellsize,n);
 
+    job.step = cellquads_step;
+    job.g = g;
+    job.lab = lab;
+    job.m = m;
+    job.n = n;
+
     for (icell = 0; icell < bigcells; ++icell)
     {
         cell1 = cellstart[icell];
         cell2 = cell1 + cellsize[icell] - 1;
-        for (iv = cell1; iv <= cell2 - 3; ++iv)
-        {
-            v = lab[iv];
-            gv = GRAPHROW(g,v,m);
-            for (iv1 = iv + 1; iv1 <= cell2 - 2; ++iv1)
-            {
-                v1 = lab[iv1];
-                gw = GRAPHROW(g,v1,m);
-                for (i = M; --i >= 0;) workset[i] = gv[i] ^ gw[i];
-                for (iv2 = iv1 + 1; iv2 <= cell2 - 1; ++iv2)
-                {
-                    v2 = lab[iv2];
-                    gw = GRAPHROW(g,v2,m);
-                    for (i = M; --i >= 0;) ws1[i] = workset[i] ^ gw[i];
-                    for (iv3 = iv2 + 1; iv3 <= cell2; ++iv3)
-                    {
-                        v3 = lab[iv3];
-                        gw = GRAPHROW(g,v3,m);
-                        pc = 0;
-                        for (i = M; --i >= 0;)
-                            if ((sw = ws1[i] ^ gw[i]) != 0)
-                                pc += POPCOUNT(sw);
-                        wt = FUZZ1(pc);
-                        ACCUM(invar[v],wt);
-                        ACCUM(invar[v1],wt);
-                        ACCUM(invar[v2],wt);
-                        ACCUM(invar[v3],wt);
-                    }
-                }
-            }
-        }
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2-3,sz*sz*sz*sz/24.0*m,FALSE);
         wt = invar[lab[cell1]];
         for (i = cell1 + 1; i <= cell2; ++i)
             if (invar[lab[i]] != wt) return;
@@ -648,74 +874,102 @@ cellquads(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
-void
-cellquins(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-          int *invar, int invararg, boolean digraph, int m, int n)
+static void
+cellquins_step(invarjob *job, int *invar, int iv)
+/* The 5-tuples {v,v1,v2,v3,v4} in the current cell with v = lab[iv] first */
 {
     int i,pc;
     setword sw;
     set *gw;
     int wt;
-    int v,iv,v1,iv1,v2,iv2,v3,iv3,v4,iv4;
-    int icell,bigcells,cell1,cell2;
-    int *cellstart,*cellsize;
+    int v,v1,iv1,v2,iv2,v3,iv3,v4,iv4;
+    int cell2,m;
+    graph *g;
+    int *lab;
     set *gv;
 
+    g = job->g;
+    lab = job->lab;
+    cell2 = job->cell2;
+    m = job->m;
 #if !MAXN
     DYNALLOC1(set,workset,workset_sz,m,"cellquins");
-    DYNALLOC1(int,workshort,workshort_sz,n+2,"cellquins");
     DYNALLOC1(set,ws1,ws1_sz,m,"cellquins");
     DYNALLOC1(set,ws2,ws2_sz,m,"cellquins");
 #endif
 
+    v = lab[iv];
+    gv = GRAPHROW(g,v,m);
+    for (iv1 = iv + 1; iv1 <= cell2 - 3; ++iv1)
+    {
+        v1 = lab[iv1];
+        gw = GRAPHROW(g,v1,m);
+        for (i = M; --i >= 0;) workset[i] = gv[i] ^ gw[i];
+        for (iv2 = iv1 + 1; iv2 <= cell2 - 2; ++iv2)
+        {
+            v2 = lab[iv2];
+            gw = GRAPHROW(g,v2,m);
+            for (i = M; --i >= 0;) ws1[i] = workset[i] ^ gw[i];
+            for (iv3 = iv2 + 1; iv3 <= cell2 - 1; ++iv3)
+            {
+                v3 = lab[iv3];
+                gw = GRAPHROW(g,v3,m);
+                for (i = M; --i >= 0;) ws2[i] = ws1[i] ^ gw[i];
+                for (iv4 = iv3 + 1; iv4 <= cell2; ++iv4)
+                {
+                    v4 = lab[iv4];
+                    gw = GRAPHROW(g,v4,m);
+                    pc = 0;
+                    for (i = M; --i >= 0;)
+                        if ((sw = ws2[i] ^ gw[i]) != 0)
+                            pc += POPCOUNT(sw);
+                    wt = FUZZ1(pc);
+                    ACCUM(invar[v],wt);
+                    ACCUM(invar[v1],wt);
+                    ACCUM(invar[v2],wt);
+                    ACCUM(invar[v3],wt);
+                    ACCUM(invar[v4],wt);
+                }
+            }
+        }
+    }
+}
+
+void
+cellquins(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+          int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    int icell,bigcells,cell1,cell2;
+    int *cellstart,*cellsize;
+    double sz;
+    invarjob job;
+
+#if !MAXN
+    DYNALLOC1(int,workshort,workshort_sz,n+2,"cellquins");
+#endif
+
     for (i = n; --i >= 0;) invar[i] = 0;
 
     cellstart = workshort;
     cellsize = workshort + (n/2);
     getbigcells(ptn,level,5,&bigcells,cellstart,cellsize,n);
 
+    job.step = cellquins_step;
+    job.g = g;
+    job.lab = lab;
+    job.m = m;
+    job.n = n;
+
     for (icell = 0; icell < bigcells; ++icell)
     {
         cell1 = cellstart[icell];
         cell2 = cell1 + cellsize[icell] - 1;
-        for (iv = cell1; iv <= cell2 - 4; ++iv)
-        {
-            v = lab[iv];
-            gv = GRAPHROW(g,v,m);
-            for (iv1 = iv + 1; iv1 <= cell2 - 3; ++iv1)
-            {
-                v1 = lab[iv1];
-                gw = GRAPHROW(g,v1,m);
-                for (i = M; --i >= 0;) workset[i] = gv[i] ^ gw[i];
-                for (iv2 = iv1 + 1; iv2 <= cell2 - 2; ++iv2)
-                {
-                    v2 = lab[iv2];
-                    gw = GRAPHROW(g,v2,m);
-                    for (i = M; --i >= 0;) ws1[i] = workset[i] ^ gw[i];
-                    for (iv3 = iv2 + 1; iv3 <= cell2 - 1; ++iv3)
-                    {
-                        v3 = lab[iv3];
-                        gw = GRAPHROW(g,v3,m);
-                        for (i = M; --i >= 0;) ws2[i] = ws1[i] ^ gw[i];
-                        for (iv4 = iv3 + 1; iv4 <= cell2; ++iv4)
-                        {
-                            v4 = lab[iv4];
-                            gw = GRAPHROW(g,v4,m);
-                            pc = 0;
-                            for (i = M; --i >= 0;)
-                                if ((sw = ws2[i] ^ gw[i]) != 0)
-                                    pc += POPCOUNT(sw);
-                            wt = FUZZ1(pc);
-                            ACCUM(invar[v],wt);
-                            ACCUM(invar[v1],wt);
-                            ACCUM(invar[v2],wt);
-                            ACCUM(invar[v3],wt);
-                            ACCUM(invar[v4],wt);
-                        }
-                    }
-                }
-            }
-        }
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2-4,sz*sz*sz*sz*sz/120.0*m,FALSE);
         wt = invar[lab[cell1]];
         for (i = cell1 + 1; i <= cell2; ++i)
             if (invar[lab[i]] != wt) return;
@@ -760,25 +1014,114 @@ uniqinter(set *s1, set *s2, int m)
 *                                                                            *
 *****************************************************************************/
 
-void 
-cellfano2(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-          int *invar, int invararg, boolean digraph, int m, int n)
+static void
+cellfano2_step(invarjob *job, int *invar, int iv0)
+/* The 4-tuples {v0,v1,v2,v3} in the current cell with v0 = lab[iv0] first */
 {
     int i,pc;
     setword sw;
     int wt;
-    int v0,v1,v2,v3,iv0,iv1,iv2,iv3;
-    int icell,bigcells,cell1,cell2;
-    int *cellstart,*cellsize;
+    int v0,v1,v2,v3,iv1,iv2,iv3;
+    int cell2,m;
     int nw,x01,x02,x03,x12,x13,x23;
     int pnt0,pnt1,pnt2;
+    graph *g;
+    int *lab;
     set *gv0,*gv1,*gv2,*gv3;
     set *gp0,*gp1,*gp2;
 
+    g = job->g;
+    lab = job->lab;
+    cell2 = job->cell2;
+    m = job->m;
+#if !MAXN
+    DYNALLOC1(int,vv,vv_sz,job->n,"cellfano2");
+    DYNALLOC1(int,ww,ww_sz,job->n,"cellfano2");
+#endif
+
+    v0 = lab[iv0];
+    gv0 = GRAPHROW(g,v0,m);
+    nw = 0;
+    for (iv1 = iv0 + 1; iv1 <= cell2; ++iv1)
+    {
+        v1 = lab[iv1];
+        if (ISELEMENT(gv0,v1)) continue;
+        if ((x01 = uniqinter(gv0,GRAPHROW(g,v1,m),m)) < 0) continue;
+        vv[nw] = v1;
+        ww[nw] = x01;
+        ++nw;
+    }
+
+    for (iv1 = 0; iv1 < nw-2; ++iv1)
+    {
+        v1 = vv[iv1];
+        gv1 = GRAPHROW(g,v1,m);
+        x01 = ww[iv1];
+
+        for (iv2 = iv1 + 1; iv2 < nw-1; ++iv2)
+        {
+            x02 = ww[iv2];
+            if (x02 == x01) continue;
+            v2 = vv[iv2];
+            if (ISELEMENT(gv1,v2)) continue;
+            gv2 = GRAPHROW(g,v2,m);
+            if ((x12 = uniqinter(gv1,gv2,m)) < 0) continue;
+
+            for (iv3 = iv2 + 1; iv3 < nw; ++iv3)
+            {
+                x03 = ww[iv3];
+                if (x03 == x01 || x03 == x02) continue;
+                v3 = vv[iv3];
+                if (ISELEMENT(gv1,v3) || ISELEMENT(gv2,v3))
+                    continue;
+                gv3 = GRAPHROW(g,v3,m);
+                if ((x13 = uniqinter(gv1,gv3,m)) < 0) continue;
+                if ((x23 = uniqinter(gv2,gv3,m)) < 0
+                                       || x23 == x13) continue;
+
+                if ((pnt0 = uniqinter(GRAPHROW(g,x01,m),
+                                     GRAPHROW(g,x23,m),m)) < 0)
+                    continue;
+                if ((pnt1 = uniqinter(GRAPHROW(g,x02,m),
+                                     GRAPHROW(g,x13,m),m)) < 0)
+                    continue;
+                if ((pnt2 = uniqinter(GRAPHROW(g,x03,m),
+                                     GRAPHROW(g,x12,m),m)) < 0)
+                    continue;
+
+                gp0 = GRAPHROW(g,pnt0,m);
+                gp1 = GRAPHROW(g,pnt1,m);
+                gp2 = GRAPHROW(g,pnt2,m);
+
+                pc = 0;
+                for (i = M; --i >= 0;)
+                {
+                    sw = gp0[i] & gp1[i] & gp2[i];
+                    if (sw) pc += POPCOUNT(sw);
+                }
+                wt = FUZZ1(pc);
+                ACCUM(invar[v0],wt);
+                ACCUM(invar[v1],wt);
+                ACCUM(invar[v2],wt);
+                ACCUM(invar[v3],wt);
+            }
+        }
+    }
+}
+
+void 
+cellfano2(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+          int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    int icell,bigcells,cell1,cell2;
+    int *cellstart,*cellsize;
+    double sz;
+    invarjob job;
+
 #if !MAXN
     DYNALLOC1(int,workshort,workshort_sz,n+2,"cellfano2");
-    DYNALLOC1(int,vv,vv_sz,n,"cellfano2");
-    DYNALLOC1(int,ww,ww_sz,n,"cellfano2");
 #endif
 
     for (i = n; --i >= 0;) invar[i] = 0;
@@ -787,81 +1130,20 @@ cellfano2(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
     cellsize = workshort + (n/2);
     getbigcells(ptn,level,4,&bigcells,cellstart,cellsize,n);
 
+    job.step = cellfano2_step;
+    job.g = g;
+    job.lab = lab;
+    job.m = m;
+    job.n = n;
+
     for (icell = 0; icell < bigcells; ++icell)
     {
         cell1 = cellstart[icell];
         cell2 = cell1 + cellsize[icell] - 1;
-        for (iv0 = cell1; iv0 <= cell2 - 3; ++iv0)
-        {
-            v0 = lab[iv0];
-            gv0 = GRAPHROW(g,v0,m);
-            nw = 0;
-            for (iv1 = iv0 + 1; iv1 <= cell2; ++iv1)
-            {
-                v1 = lab[iv1];
-                if (ISELEMENT(gv0,v1)) continue;
-                if ((x01 = uniqinter(gv0,GRAPHROW(g,v1,m),m)) < 0) continue;
-                vv[nw] = v1;
-                ww[nw] = x01;
-                ++nw;
-            }
-
-            for (iv1 = 0; iv1 < nw-2; ++iv1)
-            {
-                v1 = vv[iv1];
-                gv1 = GRAPHROW(g,v1,m);
-                x01 = ww[iv1];
-
-                for (iv2 = iv1 + 1; iv2 < nw-1; ++iv2)
-                {
-                    x02 = ww[iv2];
-                    if (x02 == x01) continue;
-                    v2 = vv[iv2];
-                    if (ISELEMENT(gv1,v2)) continue;
-                    gv2 = GRAPHROW(g,v2,m);
-                    if ((x12 = uniqinter(gv1,gv2,m)) < 0) continue;
-
-                    for (iv3 = iv2 + 1; iv3 < nw; ++iv3)
-                    {
-                        x03 = ww[iv3];
-                        if (x03 == x01 || x03 == x02) continue;
-                        v3 = vv[iv3];
-                        if (ISELEMENT(gv1,v3) || ISELEMENT(gv2,v3))
-                            continue;
-                        gv3 = GRAPHROW(g,v3,m);
-                        if ((x13 = uniqinter(gv1,gv3,m)) < 0) continue;
-                        if ((x23 = uniqinter(gv2,gv3,m)) < 0
-                                               || x23 == x13) continue;
-
-                        if ((pnt0 = uniqinter(GRAPHROW(g,x01,m),
-                                             GRAPHROW(g,x23,m),m)) < 0)
-                            continue;
-                        if ((pnt1 = uniqinter(GRAPHROW(g,x02,m),
-                                             GRAPHROW(g,x13,m),m)) < 0)
-                            continue;
-                        if ((pnt2 = uniqinter(GRAPHROW(g,x03,m),
-                                             GRAPHROW(g,x12,m),m)) < 0)
-                            continue;
-
-                        gp0 = GRAPHROW(g,pnt0,m);
-                        gp1 = GRAPHROW(g,pnt1,m);
-                        gp2 = GRAPHROW(g,pnt2,m);
-
-                        pc = 0;
-                        for (i = M; --i >= 0;)
-                        {
-                            sw = gp0[i] & gp1[i] & gp2[i];
-                            if (sw) pc += POPCOUNT(sw);
-                        }
-                        wt = FUZZ1(pc);
-                        ACCUM(invar[v0],wt);
-                        ACCUM(invar[v1],wt);
-                        ACCUM(invar[v2],wt);
-                        ACCUM(invar[v3],wt);
-                    }
-                }
-            }
-        }
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2-3,sz*sz*sz/6.0*m,FALSE);
         wt = invar[lab[cell1]];
         for (i = cell1 + 1; i <= cell2; ++i)
             if (invar[lab[i]] != wt) return;
@@ -909,20 +1191,25 @@ setnbhd(graph *g, int m, int n, set *w, set *wn)
 *                                                                            *
 *****************************************************************************/
 
-void 
-cellfano(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-         int *invar, int invararg, boolean digraph, int m, int n)
+static void
+cellfano_step(invarjob *job, int *invar, int iv0)
+/* The 4-tuples {v0,v1,v2,v3} in the current cell with v0 = lab[iv0] first */
 {
     int i,pc;
     setword sw;
     int wt;
-    int v0,v1,v2,v3,iv0,iv1,iv2,iv3;
-    int icell,bigcells,cell1,cell2;
-    int *cellstart,*cellsize;
+    int v0,v1,v2,v3,iv1,iv2,iv3;
+    int cell2,m,n;
+    graph *g;
+    int *lab;
     set *gv0,*gv1,*gv2,*gv3;
 
+    g = job->g;
+    lab = job->lab;
+    cell2 = job->cell2;
+    m = job->m;
+    n = job->n;
 #if !MAXN
-    DYNALLOC1(int,workshort,workshort_sz,n+2,"cellfano");
     DYNALLOC1(set,w01,w01_sz,m,"cellfano");
     DYNALLOC1(set,w02,w02_sz,m,"cellfano");
     DYNALLOC1(set,w03,w03_sz,m,"cellfano");
@@ -933,77 +1220,100 @@ cellfano(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
     DYNALLOC1(set,pt1,pt1_sz,m,"cellfano");
     DYNALLOC1(set,pt2,pt2_sz,m,"cellfano");
     DYNALLOC1(set,workset,workset_sz,m,"cellfano");
-#else
 #endif
 
-    for (i = n; --i >= 0;) invar[i] = 0;
+    v0 = lab[iv0];
+    gv0 = GRAPHROW(g,v0,m);
+    for (iv1 = iv0 + 1; iv1 <= cell2 - 2; ++iv1)
+    {
+        v1 = lab[iv1];
+        if (ISELEMENT(gv0,v1)) continue;
+        gv1 = GRAPHROW(g,v1,m);
+        for (i = M; --i >= 0;) workset[i] = gv0[i] & gv1[i];
+        setnbhd(g,m,n,workset,w01);
 
-    cellstart = workshort;
-    cellsize = workshort + (n/2);
-    getbigcells(ptn,level,4,&bigcells,cellstart,cellsize,n);
+        for (iv2 = iv1 + 1; iv2 <= cell2 - 1; ++iv2)
+        {
+            v2 = lab[iv2];
+            if (ISELEMENT(gv0,v2) || ISELEMENT(gv1,v2))
+                continue;
+            gv2 = GRAPHROW(g,v2,m);
+            for (i = M; --i >= 0;) workset[i] = gv0[i] & gv2[i];
+            setnbhd(g,m,n,workset,w02);
+            for (i = M; --i >= 0;) workset[i] = gv1[i] & gv2[i];
+            setnbhd(g,m,n,workset,w12);
 
-    for (icell = 0; icell < bigcells; ++icell)
-    {
-        cell1 = cellstart[icell];
-        cell2 = cell1 + cellsize[icell] - 1;
-        for (iv0 = cell1; iv0 <= cell2 - 3; ++iv0)
-        {
-            v0 = lab[iv0];
-            gv0 = GRAPHROW(g,v0,m);
-            for (iv1 = iv0 + 1; iv1 <= cell2 - 2; ++iv1)
+            for (iv3 = iv2 + 1; iv3 <= cell2; ++iv3)
             {
-                v1 = lab[iv1];
-                if (ISELEMENT(gv0,v1)) continue;
-                gv1 = GRAPHROW(g,v1,m);
-                for (i = M; --i >= 0;) workset[i] = gv0[i] & gv1[i];
-                setnbhd(g,m,n,workset,w01);
-
-                for (iv2 = iv1 + 1; iv2 <= cell2 - 1; ++iv2)
+                v3 = lab[iv3];
+                if (ISELEMENT(gv0,v3) || ISELEMENT(gv1,v3) ||
+                            ISELEMENT(gv2,v3))
+                    continue;
+                gv3 = GRAPHROW(g,v3,m);
+                for (i = M; --i >= 0;) workset[i] = gv0[i] & gv3[i];
+                setnbhd(g,m,n,workset,w03);
+                for (i = M; --i >= 0;) workset[i] = gv1[i] & gv3[i];
+                setnbhd(g,m,n,workset,w13);
+                for (i = M; --i >= 0;) workset[i] = gv2[i] & gv3[i];
+                setnbhd(g,m,n,workset,w23);
+            
+                for (i = M; --i >= 0;) workset[i] = w01[i] & w23[i];
+                setnbhd(g,m,n,workset,pt0);
+                for (i = M; --i >= 0;) workset[i] = w03[i] & w12[i];
+                setnbhd(g,m,n,workset,pt1);
+                for (i = M; --i >= 0;) workset[i] = w02[i] & w13[i];
+                setnbhd(g,m,n,workset,pt2);
+                pc = 0;
+                for (i = M; --i >= 0;)
                 {
-                    v2 = lab[iv2];
-                    if (ISELEMENT(gv0,v2) || ISELEMENT(gv1,v2))
-                        continue;
-                    gv2 = GRAPHROW(g,v2,m);
-                    for (i = M; --i >= 0;) workset[i] = gv0[i] & gv2[i];
-                    setnbhd(g,m,n,workset,w02);
-                    for (i = M; --i >= 0;) workset[i] = gv1[i] & gv2[i];
-                    setnbhd(g,m,n,workset,w12);
-
-                    for (iv3 = iv2 + 1; iv3 <= cell2; ++iv3)
-                    {
-                        v3 = lab[iv3];
-                        if (ISELEMENT(gv0,v3) || ISELEMENT(gv1,v3) ||
-                                    ISELEMENT(gv2,v3))
-                            continue;
-                        gv3 = GRAPHROW(g,v3,m);
-                        for (i = M; --i >= 0;) workset[i] = gv0[i] & gv3[i];
-                        setnbhd(g,m,n,workset,w03);
-                        for (i = M; --i >= 0;) workset[i] = gv1[i] & gv3[i];
-                        setnbhd(g,m,n,workset,w13);
-                        for (i = M; --i >= 0;) workset[i] = gv2[i] & gv3[i];
-                        setnbhd(g,m,n,workset,w23);
-                    
-                        for (i = M; --i >= 0;) workset[i] = w01[i] & w23[i];
-                        setnbhd(g,m,n,workset,pt0);
-                        for (i = M; --i >= 0;) workset[i] = w03[i] & w12[i];
-                        setnbhd(g,m,n,workset,pt1);
-                        for (i = M; --i >= 0;) workset[i] = w02[i] & w13[i];
-                        setnbhd(g,m,n,workset,pt2);
-                        pc = 0;
-                        for (i = M; --i >= 0;)
-                        {
-                            sw = pt0[i] & pt1[i] & pt2[i];
-                            if (sw) pc += POPCOUNT(sw);
-                        }
-                        wt = FUZZ1(pc);
-                        ACCUM(invar[v0],wt);
-                        ACCUM(invar[v1],wt);
-                        ACCUM(invar[v2],wt);
-                        ACCUM(invar[v3],wt);
-                    }
+                    sw = pt0[i] & pt1[i] & pt2[i];
+                    if (sw) pc += POPCOUNT(sw);
                 }
+                wt = FUZZ1(pc);
+                ACCUM(invar[v0],wt);
+                ACCUM(invar[v1],wt);
+                ACCUM(invar[v2],wt);
+                ACCUM(invar[v3],wt);
             }
         }
+    }
+}
+
+void 
+cellfano(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+         int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    int icell,bigcells,cell1,cell2;
+    int *cellstart,*cellsize;
+    double sz;
+    invarjob job;
+
+#if !MAXN
+    DYNALLOC1(int,workshort,workshort_sz,n+2,"cellfano");
+#endif
+
+    for (i = n; --i >= 0;) invar[i] = 0;
+
+    cellstart = workshort;
+    cellsize = workshort + (n/2);
+    getbigcells(ptn,level,4,&bigcells,cellstart,cellsize,n);
+
+    job.step = cellfano_step;
+    job.g = g;
+    job.lab = lab;
+    job.m = m;
+    job.n = n;
+
+    for (icell = 0; icell < bigcells; ++icell)
+    {
+        cell1 = cellstart[icell];
+        cell2 = cell1 + cellsize[icell] - 1;
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2-3,sz*sz*sz*sz/24.0*m,FALSE);
         wt = invar[lab[cell1]];
         for (i = cell1 + 1; i <= cell2; ++i)
             if (invar[lab[i]] != wt) return;
@@ -1019,21 +1329,67 @@ cellfano(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
+static void
+distances_step(invarjob *job, int *invar, int iv)
+/* The distances from v = lab[iv] */
+{
+    int i;
+    set *gw;
+    int wt;
+    int d,dlim,v,w,m;
+    graph *g;
+    int *weight;
+
+    g = job->g;
+    weight = job->weight;
+    dlim = job->setsize;
+    m = job->m;
+#if !MAXN
+    DYNALLOC1(set,workset,workset_sz,m,"distances");
+    DYNALLOC1(set,ws1,ws1_sz,m,"distances");
+    DYNALLOC1(set,ws2,ws2_sz,m,"distances"); 
+#endif
+
+    v = job->lab[iv];
+    EMPTYSET(ws1,m);
+    ADDELEMENT(ws1,v);
+    EMPTYSET(ws2,m);
+    ADDELEMENT(ws2,v);
+    for (d = 1; d < dlim; ++d)
+    {
+        EMPTYSET(workset,m);
+        wt = 0;
+        w = -1;
+        while ((w = nextelement(ws2,M,w)) >= 0)
+        {
+            gw = GRAPHROW(g,w,m);
+            ACCUM(wt,weight[w]);
+            for (i = M; --i >= 0;) workset[i] |= gw[i];
+        }
+        if (wt == 0) break;
+        ACCUM(wt,d);
+        wt = FUZZ2(wt);
+        ACCUM(invar[v],wt);
+        for (i = M; --i >= 0;)
+        {
+            ws2[i] = workset[i] & ~ws1[i];
+            ws1[i] |= ws2[i];
+        }
+    }
+}
+
 void
 distances(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
           int *invar, int invararg, boolean digraph, int m, int n)
 {
     int i;
-    set *gw;
     int wt;
-    int d,dlim,cell1,cell2,iv,v,w;
+    int cell1,cell2,iv;
     boolean success;
+    invarjob job;
 
 #if !MAXN
-    DYNALLOC1(set,workset,workset_sz,m,"distances");
     DYNALLOC1(int,workshort,workshort_sz,n+2,"distances");
-    DYNALLOC1(set,ws1,ws1_sz,m,"distances");
-    DYNALLOC1(set,ws2,ws2_sz,m,"distances"); 
 #endif
 
     for (i = n; --i >= 0;) invar[i] = 0;
@@ -1045,8 +1401,14 @@ distances(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         if (ptn[i] <= level) ++wt;
     }
 
-    if (invararg > n || invararg == 0) dlim = n;
-    else                               dlim = invararg+1;
+    job.step = distances_step;
+    job.g = g;
+    job.lab = lab;
+    job.weight = workshort;
+    job.m = m;
+    job.n = n;
+    if (invararg > n || invararg == 0) job.setsize = n;
+    else                               job.setsize = invararg+1;
 
     success = FALSE;
     for (cell1 = 0; cell1 < n; cell1 = cell2 + 1)
@@ -1054,36 +1416,10 @@ distances(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         for (cell2 = cell1; ptn[cell2] > level; ++cell2) {}
         if (cell2 == cell1) continue;
 
-        for (iv = cell1; iv <= cell2; ++iv)
-        {
-            v = lab[iv];
-            EMPTYSET(ws1,m);
-            ADDELEMENT(ws1,v);
-            EMPTYSET(ws2,m);
-            ADDELEMENT(ws2,v);
-            for (d = 1; d < dlim; ++d)
-            {
-                EMPTYSET(workset,m);
-                wt = 0;
-                w = -1;
-                while ((w = nextelement(ws2,M,w)) >= 0)
-                {
-                    gw = GRAPHROW(g,w,m);
-                    ACCUM(wt,workshort[w]);
-                    for (i = M; --i >= 0;) workset[i] |= gw[i];
-                }
-                if (wt == 0) break;
-                ACCUM(wt,d);
-                wt = FUZZ2(wt);
-                ACCUM(invar[v],wt);
-                for (i = M; --i >= 0;)
-                {
-                    ws2[i] = workset[i] & ~ws1[i];
-                    ws1[i] |= ws2[i];
-                }
-            }
-            if (invar[v] != invar[lab[cell1]]) success = TRUE;
-        }
+        runinvarjob(&job,invar,cell1,cell2,
+                    (double)(cell2-cell1+1)*n*m,FALSE);
+        for (iv = cell1 + 1; iv <= cell2; ++iv)
+            if (invar[lab[iv]] != invar[lab[cell1]]) success = TRUE;
         if (success) break;
     }
 }
@@ -1096,30 +1432,79 @@ distances(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
-void
-indsets(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-        int *invar, int invararg, boolean digraph, int m, int n)
+static void
+indsets_step(invarjob *job, int *invar, int v0)
+/* The independent sets whose least vertex is v0 */
 {
     int i;
     int wt;
     set *gv;
-    int ss,setsize;
+    int ss,setsize,m,n;
     int v[MAXCLIQUE];
     long wv[MAXCLIQUE];
     set *s0,*s1;
+    graph *g;
+    int *weight;
+
+    g = job->g;
+    weight = job->weight;
+    setsize = job->setsize;
+    m = job->m;
+    n = job->n;
+#if !MAXN
+    DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"indsets");
+#endif
+
+    v[0] = v0;
+    wv[0] = weight[v[0]];
+    s0 = (set*)wss;
+    EMPTYSET(s0,m);
+    for (i = v[0]+1; i < n; ++i) ADDELEMENT(s0,i);
+    gv = GRAPHROW(g,v[0],m);
+    for (i = M; --i >= 0;) s0[i] &= ~gv[i];
+    ss = 1;
+    v[1] = v[0];
+    while (ss > 0)
+    {
+        if (ss == setsize)
+        {
+            wt = FUZZ1(wv[ss-1]);
+            for (i = ss; --i >= 0;) ACCUM(invar[v[i]],wt);
+            --ss;
+        }
+        else if ((v[ss] = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
+            --ss;
+        else
+        {
+            wv[ss] = wv[ss-1] + weight[v[ss]];
+            ++ss;
+            if (ss < setsize)
+            {
+                gv = GRAPHROW(g,v[ss-1],m);
+                s1 = (set*)wss + M*(ss-2);
+                for (i = M; --i >= 0;) s1[i+M] = s1[i] & ~gv[i];
+                v[ss] = v[ss-1];
+            }
+        }
+    }
+}
+
+void
+indsets(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+        int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    invarjob job;
 
 #if !MAXN
     DYNALLOC1(int,workshort,workshort_sz,n+2,"indsets");
-    DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"indsets");
 #endif
 
     for (i = n; --i >= 0;) invar[i] = 0;
 
     if (invararg <= 1 || digraph) return;
 
-    if (invararg > MAXCLIQUE) setsize = MAXCLIQUE;
-    else                      setsize = invararg;
-
     wt = 1;
     for (i = 0; i < n; ++i)
     {
@@ -1127,40 +1512,16 @@ indsets(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         if (ptn[i] <= level) ++wt;
     }
 
-    for (v[0] = 0; v[0] < n; ++v[0])
-    {
-        wv[0] = workshort[v[0]];
-        s0 = (set*)wss;
-        EMPTYSET(s0,m);
-        for (i = v[0]+1; i < n; ++i) ADDELEMENT(s0,i);
-        gv = GRAPHROW(g,v[0],m);
-        for (i = M; --i >= 0;) s0[i] &= ~gv[i];
-        ss = 1;
-        v[1] = v[0];
-        while (ss > 0)
-        {
-            if (ss == setsize)
-            {
-                wt = FUZZ1(wv[ss-1]);
-                for (i = ss; --i >= 0;) ACCUM(invar[v[i]],wt);
-                --ss;
-            }
-            else if ((v[ss] = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
-                --ss;
-            else
-            {
-                wv[ss] = wv[ss-1] + workshort[v[ss]];
-                ++ss;
-                if (ss < setsize)
-                {
-                    gv = GRAPHROW(g,v[ss-1],m);
-                    s1 = (set*)wss + M*(ss-2);
-                    for (i = M; --i >= 0;) s1[i+M] = s1[i] & ~gv[i];
-                    v[ss] = v[ss-1];
-                }
-            }
-        }
-    }
+    job.step = indsets_step;
+    job.g = g;
+    job.lab = lab;
+    job.weight = workshort;
+    job.m = m;
+    job.n = n;
+    if (invararg > MAXCLIQUE) job.setsize = MAXCLIQUE;
+    else                      job.setsize = invararg;
+
+    runinvarjob(&job,invar,0,n-1,(double)n*n*m,FALSE);
 }
 
 /*****************************************************************************
@@ -1171,32 +1532,76 @@ indsets(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
-void
-cliques(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
-        int *invar, int invararg, boolean digraph, int m, int n)
+static void
+cliques_step(invarjob *job, int *invar, int v0)
+/* The cliques whose least vertex is v0 */
 {
     int i;
     int wt;
     set *gv;
-    int ss,setsize;
+    int ss,setsize,m;
     int v[MAXCLIQUE];
     long wv[MAXCLIQUE];
     set *ns;
+    graph *g;
+    int *weight;
 
+    g = job->g;
+    weight = job->weight;
+    setsize = job->setsize;
+    m = job->m;
 #if !MAXN
-    DYNALLOC1(int,workshort,workshort_sz,n+2,"cliques");
     DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"cliques");
-#else
-    set wss[MAXCLIQUE-1][MAXM];
+#endif
+
+    v[0] = v0;
+    wv[0] = weight[v[0]];
+    gv = GRAPHROW(g,v[0],m);
+    ns = (set*)wss;
+    for (i = M; --i >= 0;) ns[i] = gv[i];
+    ss = 1;
+    v[1] = v[0];
+    while (ss > 0)
+    {
+        if (ss == setsize)
+        {
+            wt = FUZZ1(wv[ss-1]);
+            for (i = ss; --i >= 0;) ACCUM(invar[v[i]],wt);
+            --ss;
+        }
+        else if ((v[ss] = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
+            --ss;
+        else
+        {
+            wv[ss] = wv[ss-1] + weight[v[ss]];
+            ++ss;
+            if (ss < setsize)
+            {
+                gv = GRAPHROW(g,v[ss-1],m);
+                ns = (set*)wss + M*(ss-2);
+                for (i = M; --i >= 0;) ns[i+M] = ns[i] & gv[i];
+                v[ss] = v[ss-1];
+            }
+        }
+    }
+}
+
+void
+cliques(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+        int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i;
+    int wt;
+    invarjob job;
+
+#if !MAXN
+    DYNALLOC1(int,workshort,workshort_sz,n+2,"cliques");
 #endif
 
     for (i = n; --i >= 0;) invar[i] = 0;
 
     if (invararg <= 1 || digraph) return;
 
-    if (invararg > MAXCLIQUE) setsize = MAXCLIQUE;
-    else                      setsize = invararg;
-
     wt = 1;
     for (i = 0; i < n; ++i)
     {
@@ -1204,38 +1609,16 @@ cliques(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         if (ptn[i] <= level) ++wt;
     }
 
-    for (v[0] = 0; v[0] < n; ++v[0])
-    {
-        wv[0] = workshort[v[0]];
-        gv = GRAPHROW(g,v[0],m);
-        ns = (set*)wss;
-        for (i = M; --i >= 0;) ns[i] = gv[i];
-        ss = 1;
-        v[1] = v[0];
-        while (ss > 0)
-        {
-            if (ss == setsize)
-            {
-                wt = FUZZ1(wv[ss-1]);
-                for (i = ss; --i >= 0;) ACCUM(invar[v[i]],wt);
-                --ss;
-            }
-            else if ((v[ss] = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
-                --ss;
-            else
-            {
-                wv[ss] = wv[ss-1] + workshort[v[ss]];
-                ++ss;
-                if (ss < setsize)
-                {
-                    gv = GRAPHROW(g,v[ss-1],m);
-                    ns = (set*)wss + M*(ss-2);
-                    for (i = M; --i >= 0;) ns[i+M] = ns[i] & gv[i];
-                    v[ss] = v[ss-1];
-                }
-            }
-        }
-    }
+    job.step = cliques_step;
+    job.g = g;
+    job.lab = lab;
+    job.weight = workshort;
+    job.m = m;
+    job.n = n;
+    if (invararg > MAXCLIQUE) job.setsize = MAXCLIQUE;
+    else                      job.setsize = invararg;
+
+    runinvarjob(&job,invar,0,n-1,(double)n*n*m,FALSE);
 }
 
 /*****************************************************************************
@@ -1247,37 +1630,96 @@ cliques(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
+static void
+cellcliq_step(invarjob *job, int *invar, int iv)
+/* The cliques in the current cell with least vertex lab[iv] */
+{
+    int i;
+    set *gv;
+    int ss,setsize,m;
+    int v[MAXCLIQUE];
+    set *ns,*cellset;
+    int pc;
+    setword sw;
+    graph *g;
+
+    g = job->g;
+    cellset = job->cellset;
+    setsize = job->setsize;
+    m = job->m;
+#if !MAXN
+    DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"cellcliq");
+#endif
+
+    v[0] = job->lab[iv];
+    gv = GRAPHROW(g,v[0],m);
+    ns = (set*)wss;
+    pc = 0;
+
+    for (i = M; --i >= 0;)
+    {
+        ns[i] = gv[i] & cellset[i];
+        if ((sw = ns[i]) != 0) pc += POPCOUNT(sw);
+    }
+    if (pc <= 1 || pc >= job->cell2 - job->cell1 - 1) return;
+
+    ss = 1;
+    v[1] = v[0];
+    while (ss > 0)
+    {
+        if (ss == setsize)
+        {
+            for (i = ss; --i >= 0;) ++invar[v[i]];
+            --ss;
+        }
+        else if ((v[ss] = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
+            --ss;
+        else
+        {
+            ++ss;
+            if (ss < setsize)
+            {
+                gv = GRAPHROW(g,v[ss-1],m);
+                ns = (set*)wss + M*(ss-2);
+                for (i = M; --i >= 0;) ns[i+M] = ns[i] & gv[i];
+                v[ss] = v[ss-1];
+            }
+        }
+    }
+}
+
 void
 cellcliq(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
          int *invar, int invararg, boolean digraph, int m, int n)
 {
     int i;
     int wt;
-    set *gv;
-    int ss,setsize;
-    int v[MAXCLIQUE];
-    set *ns;
     int *cellstart,*cellsize;
     int iv,icell,bigcells,cell1,cell2;
-    int pc;
-    setword sw;
+    double sz;
+    invarjob job;
 
 #if !MAXN
     DYNALLOC1(set,workset,workset_sz,m,"cellcliq");
     DYNALLOC1(int,workshort,workshort_sz,n+2,"cellcliq");
-    DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"cellcliq");
 #endif
 
     for (i = n; --i >= 0;) invar[i] = 0;
 
     if (invararg <= 1 || digraph) return;
 
-    if (invararg > MAXCLIQUE) setsize = MAXCLIQUE;
-    else                      setsize = invararg;
+    job.step = cellcliq_step;
+    job.g = g;
+    job.lab = lab;
+    job.cellset = workset;
+    job.m = m;
+    job.n = n;
+    if (invararg > MAXCLIQUE) job.setsize = MAXCLIQUE;
+    else                      job.setsize = invararg;
 
     cellstart = workshort;
     cellsize = workshort + (n/2);
-    getbigcells(ptn,level,setsize > 6 ? setsize : 6,&bigcells,
+    getbigcells(ptn,level,job.setsize > 6 ? job.setsize : 6,&bigcells,
                 cellstart,cellsize,n);
 
     for (icell = 0; icell < bigcells; ++icell)
@@ -1288,45 +1730,11 @@ cellcliq(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         EMPTYSET(workset,m);
         for (iv = cell1; iv <= cell2; ++iv) ADDELEMENT(workset,lab[iv]);
 
-        for (iv = cell1; iv <= cell2; ++iv)
-        {
-            v[0] = lab[iv];
-            gv = GRAPHROW(g,v[0],m);
-            ns = (set*)wss;
-            pc = 0;
-
-            for (i = M; --i >= 0;)
-            {
-                ns[i] = gv[i] & workset[i];
-                if ((sw = ns[i]) != 0) pc += POPCOUNT(sw);
-            }
-            if (pc <= 1 || pc >= cellsize[icell] - 2) continue;
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2,sz*sz*m,TRUE);
 
-            ss = 1;
-            v[1] = v[0];
-            while (ss > 0)
-            {
-                if (ss == setsize)
-                {
-                    for (i = ss; --i >= 0;) ++invar[v[i]];
-                    --ss;
-                }
-                else if ((v[ss] 
-                            = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
-                    --ss;
-                else
-                {
-                    ++ss;
-                    if (ss < setsize)
-                    {
-                        gv = GRAPHROW(g,v[ss-1],m);
-                        ns = (set*)wss + M*(ss-2);
-                        for (i = M; --i >= 0;) ns[i+M] = ns[i] & gv[i];
-                        v[ss] = v[ss-1];
-                    }
-                }
-            }
-        }
         wt = invar[lab[cell1]];
         for (iv = cell1 + 1; iv <= cell2; ++iv)
             if (invar[lab[iv]] != wt) return;
@@ -1343,37 +1751,96 @@ cellcliq(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
+static void
+cellind_step(invarjob *job, int *invar, int iv)
+/* The independent sets in the current cell with least vertex lab[iv] */
+{
+    int i;
+    set *gv;
+    int ss,setsize,m;
+    int v[MAXCLIQUE];
+    set *ns,*cellset;
+    int pc;
+    setword sw;
+    graph *g;
+
+    g = job->g;
+    cellset = job->cellset;
+    setsize = job->setsize;
+    m = job->m;
+#if !MAXN
+    DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"cellind");
+#endif
+
+    v[0] = job->lab[iv];
+    gv = GRAPHROW(g,v[0],m);
+    ns = (set*)wss;
+    pc = 0;
+
+    for (i = M; --i >= 0;)
+    {
+        ns[i] = ~gv[i] & cellset[i];
+        if ((sw = ns[i]) != 0) pc += POPCOUNT(sw);
+    }
+    if (pc <= 1 || pc >= job->cell2 - job->cell1 - 1) return;
+
+    ss = 1;
+    v[1] = v[0];
+    while (ss > 0)
+    {
+        if (ss == setsize)
+        {
+            for (i = ss; --i >= 0;) ++invar[v[i]];
+            --ss;
+        }
+        else if ((v[ss] = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
+            --ss;
+        else
+        {
+            ++ss;
+            if (ss < setsize)
+            {
+                gv = GRAPHROW(g,v[ss-1],m);
+                ns = (set*)wss + M*(ss-2);
+                for (i = M; --i >= 0;) ns[i+M] = ns[i] & ~gv[i];
+                v[ss] = v[ss-1];
+            }
+        }
+    }
+}
+
 void
 cellind(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         int *invar, int invararg, boolean digraph, int m, int n)
 {
     int i;
     int wt;
-    set *gv;
-    int ss,setsize;
-    int v[MAXCLIQUE];
-    set *ns;
     int *cellstart,*cellsize;
     int iv,icell,bigcells,cell1,cell2;
-    int pc;
-    setword sw;
+    double sz;
+    invarjob job;
 
 #if !MAXN
     DYNALLOC1(set,workset,workset_sz,m,"cellind");
     DYNALLOC1(int,workshort,workshort_sz,n+2,"cellind");
-    DYNALLOC2(set,wss,wss_sz,m,MAXCLIQUE-1,"cellind");
 #endif
 
     for (i = n; --i >= 0;) invar[i] = 0;
 
     if (invararg <= 1 || digraph) return;
 
-    if (invararg > MAXCLIQUE) setsize = MAXCLIQUE;
-    else                      setsize = invararg;
+    job.step = cellind_step;
+    job.g = g;
+    job.lab = lab;
+    job.cellset = workset;
+    job.m = m;
+    job.n = n;
+    if (invararg > MAXCLIQUE) job.setsize = MAXCLIQUE;
+    else                      job.setsize = invararg;
 
     cellstart = workshort;
     cellsize = workshort + (n/2);
-    getbigcells(ptn,level,setsize > 6 ? setsize : 6,&bigcells,
+    getbigcells(ptn,level,job.setsize > 6 ? job.setsize : 6,&bigcells,
                 cellstart,cellsize,n);
 
     for (icell = 0; icell < bigcells; ++icell)
@@ -1384,45 +1851,11 @@ cellind(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         EMPTYSET(workset,m);
         for (iv = cell1; iv <= cell2; ++iv) ADDELEMENT(workset,lab[iv]);
 
-        for (iv = cell1; iv <= cell2; ++iv)
-        {
-            v[0] = lab[iv];
-            gv = GRAPHROW(g,v[0],m);
-            ns = (set*)wss;
-            pc = 0;
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+        runinvarjob(&job,invar,cell1,cell2,sz*sz*m,TRUE);
 
-            for (i = M; --i >= 0;)
-            {
-                ns[i] = ~gv[i] & workset[i];
-                if ((sw = ns[i]) != 0) pc += POPCOUNT(sw);
-            }
-            if (pc <= 1 || pc >= cellsize[icell] - 2) continue;
-
-            ss = 1;
-            v[1] = v[0];
-            while (ss > 0)
-            {
-                if (ss == setsize)
-                {
-                    for (i = ss; --i >= 0;) ++invar[v[i]];
-                    --ss;
-                }
-                else if ((v[ss] 
-                       = nextelement((set*)wss+M*(ss-1),M,v[ss])) < 0)
-                    --ss;
-                else
-                {
-                    ++ss;
-                    if (ss < setsize)
-                    {
-                        gv = GRAPHROW(g,v[ss-1],m);
-                        ns = (set*)wss + M*(ss-2);
-                        for (i = M; --i >= 0;) ns[i+M] = ns[i] & ~gv[i];
-                        v[ss] = v[ss-1];
-                    }
-                }
-            }
-        }
         wt = invar[lab[cell1]];
         for (iv = cell1 + 1; iv <= cell2; ++iv)
             if (invar[lab[iv]] != wt) return;
@@ -1438,13 +1871,37 @@ cellind(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
 *                                                                            *
 *****************************************************************************/
 
+static void
+adjacencies_step(invarjob *job, int *invar, int v)
+/* The arcs out of v */
+{
+    int w,m;
+    int vwt,wwt;
+    set *gv;
+    int *weight;
+
+    weight = job->weight;
+    m = job->m;
+
+    gv = GRAPHROW(job->g,v,m);
+    vwt = FUZZ1(weight[v]);
+    wwt = 0;
+    w = -1;
+    while ((w = nextelement(gv,M,w)) >= 0)
+    {
+        ACCUM(wwt,FUZZ2(weight[w]));
+        ACCUM(invar[w],vwt);
+    }
+    ACCUM(invar[v],wwt);
+}
+
 void
 adjacencies(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
             int *invar, int invararg, boolean digraph, int m, int n)
 {
-    int i,v,w;
-    int vwt,wwt;
-    set *gv;
+    int i;
+    int vwt;
+    invarjob job;
 
 #if !MAXN
     DYNALLOC1(int,workshort,workshort_sz,n+2,"adjacencies");
@@ -1458,18 +1915,14 @@ adjacencies(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
         invar[i] = 0;
     }
 
-    for (v = 0, gv = (set*)g; v < n; ++v, gv += M)
-    {
-        vwt = FUZZ1(workshort[v]);
-        wwt = 0;
-        w = -1;
-        while ((w = nextelement(gv,M,w)) >= 0)
-        {
-            ACCUM(wwt,FUZZ2(workshort[w]));
-            ACCUM(invar[w],vwt);
-        }
-        ACCUM(invar[v],wwt);
-    }
+    job.step = adjacencies_step;
+    job.g = g;
+    job.lab = lab;
+    job.weight = workshort;
+    job.m = m;
+    job.n = n;
+
+    runinvarjob(&job,invar,0,n-1,(double)n*n,FALSE);
 }
 
 /*****************************************************************************
@@ -1750,3 +2203,102 @@ refinvar(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
             if (invar[lab[i]] != wt) return;
     }
 }
+
+/*****************************************************************************
+*                                                                            *
+*  adaptinvar() is for highly regular graphs, where it is not clear in       *
+*  advance which invariant will help.  If the partition is still coarse      *
+*  (at most n/2 cells), the non-trivial cells are taken in increasing        *
+*  order of size.  For each cell, the invariants distances(), cellquads()    *
+*  and cellfano2() restricted to that cell are tried in increasing order     *
+*  of estimated work, skipping any whose estimate exceeds invararg million   *
+*  operations (100 million if invararg <= 0).  The values of the first one   *
+*  which splits a cell are returned.  The estimates depend only on the cell  *
+*  sizes, so the choice is the same for equivalent nodes and the canonical   *
+*  labelling remains valid.                                                  *
+*                                                                            *
+*****************************************************************************/
+
+void 
+adaptinvar(graph *g, int *lab, int *ptn, int level, int numcells, int tvpos,
+           int *invar, int invararg, boolean digraph, int m, int n)
+{
+    int i,j,k;
+    int wt;
+    int icell,bigcells,cell1,cell2;
+    int *cellstart,*cellsize;
+    double sz,budget;
+    double work[3];
+    int order[3],last[3];
+    static void (*const step[3])(invarjob*,int*,int)
+        = {distances_step,cellquads_step,cellfano2_step};
+    invarjob job;
+
+#if !MAXN
+    DYNALLOC1(int,workshort,workshort_sz,n+2,"adaptinvar");
+    DYNALLOC1(int,workperm,workperm_sz,n,"adaptinvar");
+#endif
+
+    for (i = n; --i >= 0;) invar[i] = 0;
+    if (numcells > n/2) return;
+
+    wt = 1;
+    for (i = 0; i < n; ++i)
+    {
+        workshort[lab[i]] = FUZZ1(wt);
+        if (ptn[i] <= level) ++wt;
+    }
+
+    cellstart = workperm;
+    cellsize = workperm + (n/2);
+    getbigcells(ptn,level,2,&bigcells,cellstart,cellsize,n);
+
+    job.g = g;
+    job.lab = lab;
+    job.weight = workshort;
+    job.setsize = n;
+    job.m = m;
+    job.n = n;
+
+    budget = (invararg > 0 ? invararg : 100) * 1e6;
+
+    for (icell = 0; icell < bigcells; ++icell)
+    {
+        cell1 = cellstart[icell];
+        cell2 = cell1 + cellsize[icell] - 1;
+        job.cell1 = cell1;
+        job.cell2 = cell2;
+        sz = cellsize[icell];
+
+        work[0] = sz*n*m;
+        last[0] = cell2;
+        if (sz >= 4)
+        {
+            work[1] = sz*sz*sz*sz/24.0*m;
+            work[2] = sz*sz*sz/6.0*m;
+        }
+        else
+            work[1] = work[2] = budget + 1.0;
+        last[1] = last[2] = cell2 - 3;
+
+        for (i = 0; i < 3; ++i)
+        {
+            for (j = i; j > 0 && work[order[j-1]] > work[i]; --j)
+                order[j] = order[j-1];
+            order[j] = i;
+        }
+
+        for (k = 0; k < 3; ++k)
+        {
+            i = order[k];
+            if (work[i] > budget) break;
+
+            job.step = step[i];
+            runinvarjob(&job,invar,cell1,last[i],work[i],FALSE);
+            wt = invar[lab[cell1]];
+            for (j = cell1 + 1; j <= cell2; ++j)
+                if (invar[lab[j]] != wt) return;
+            for (j = n; --j >= 0;) invar[j] = 0;
+        }
+    }
+}
@@ -7,6 +7,7 @@
 *   CHANGE HISTORY                                                           *
 *       20-Apr-01 : initial creation out of naututil.h                       *
 *       10-Nov-10 : remove types shortish and permutation                    *
+*       19-Oct-26 : add nautinv_threads() and adaptinvar()                   *
 *                                                                            *
 *****************************************************************************/
 
@@ -16,6 +17,7 @@
 extern "C" {
 #endif
 
+extern void adaptinvar(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
 extern void adjacencies(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
 extern void adjtriang(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
 extern void cellcliq(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
@@ -32,6 +34,7 @@ extern void getbigcells(int*,int,int,int*,int*,int*,int);
 extern void indsets(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
 extern void nautinv_check(int,int,int,int);
 extern void nautinv_freedyn(void);
+extern int nautinv_threads(int);
 extern void quadruples(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
 extern void refinvar(graph*,int*,int*,int,int,int,int*,int,boolean,int,int);
 extern void setnbhd(graph*,int,int,set*,set*);
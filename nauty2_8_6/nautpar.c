@@ -0,0 +1,1101 @@
+/*****************************************************************************
+*                                                                            *
+*  Parallel search at the top level of nauty and Traces.                     *
+*                                                                            *
+*  parallelnauty() has the same parameters as nauty(), and parallelTraces()  *
+*  the same parameters as Traces(), each with an extra one giving the        *
+*  number of threads to use.  They divide the search tree at the root        *
+*  between the threads, as follows.  Let T be the target cell at the root    *
+*  and v0 the least vertex in T.  For each v in T, let C(v) be the           *
+*  canonical graph found by nauty() (or Traces()) for the partition got      *
+*  from the root partition by individualising v.                             *
+*                                                                            *
+*  First nauty() is called for v0, giving the stabiliser of v0 and C(v0).    *
+*  Then nauty() is called for the other vertices of T in parallel.  If       *
+*  C(v) = C(v0), the two canonical labellings give an automorphism mapping   *
+*  v0 to v.  Since C(v) is constant on orbits, v is skipped if it is in the  *
+*  same orbit of the group found so far as a vertex already tried.           *
+*                                                                            *
+*  If options->getcanon is TRUE, the canonical graph is the least C(v)       *
+*  found.  This is a canonical form, but in general not the same one as      *
+*  that found by nauty() or Traces().  The automorphism group, orbits and    *
+*  group size are the same.                                                  *
+*                                                                            *
+*  Automorphisms and markers are written as by nauty(), the automorphisms    *
+*  found at the root coming after those of the stabiliser of v0.  The        *
+*  generators written form a strong generating set relative to the base      *
+*  given by the markers.  The userautomproc and userlevelproc procedures     *
+*  are called in the search for v0 and at the root; usernodeproc and         *
+*  usercanonproc are not called.                                             *
+*                                                                            *
+*  For Traces, the root partition is refined by refine_sg() and T is the     *
+*  first largest cell, since that gives the most work to share.  If          *
+*  options->generators is not NULL, the generators of the stabiliser of v0   *
+*  and those found at the root are added to it.  A nonempty list of known    *
+*  generators on entry, or weighted edges, are not supported by the          *
+*  parallel search, and Traces() is called instead.                          *
+*  parallelTraces() is not a speedup in practice: each child is a full       *
+*  Traces() search without the pruning Traces() itself does at the root.     *
+*                                                                            *
+*  More than one thread is only used if nauty was configured with            *
+*  --enable-tls (so that nauty() and Traces() can run in several threads at  *
+*  once), and the Posix threads library is linked.  Otherwise, and if        *
+*  nthreads <= 1, these procedures just call nauty() or Traces().            *
+*                                                                            *
+*   CHANGE HISTORY                                                           *
+*       18-Oct-26 : initial creation                                         *
+*       19-Oct-26 : add parallelTraces()                                     *
+*                                                                            *
+*****************************************************************************/
+
+#include "nautpar.h"
+#include "nausparse.h"
+#include "schreier.h"
+
+#if HAVE_TLS && !MAXN
+#include <pthread.h>
+#define PARALLEL_OK 1
+#else
+#define PARALLEL_OK 0
+#endif
+
+#define OPTCALL(proc) if (proc != NULL) (*proc)
+
+#if PARALLEL_OK
+
+#define STACKSIZE (64L*1024L*1024L)  /* stack size for worker threads */
+
+typedef struct
+{
+    int v;            /* a vertex of the target cell */
+    int *p;           /* an automorphism mapping v0 to v */
+} rootautom;
+
+typedef struct
+{
+    graph *g;
+    int m,n;
+    boolean sparse;
+    boolean traces;          /* searching with Traces() rather than nauty() */
+    optionblk opts;          /* options for the searches below the root */
+    TracesOptions topts;     /* the same for Traces() */
+    int worksize;            /* worksize for each thread */
+    int *rootlab,*rootptn;   /* refined partition at the root */
+    int tc;                  /* position of the target cell in rootlab */
+    int *cell,cellsize;      /* the target cell, in increasing order */
+    int next;                /* next position in cell to try */
+    int *lab0;               /* canonical labelling for v0 = cell[0] */
+    graph *canon0;           /* C(v0) */
+    boolean getcanon;        /* keep the least C(v) found? */
+    int bestv,*bestlab;
+    graph *bestcanon;
+    int *orbits;             /* orbits of the group found so far */
+    boolean *started;        /* started[orbits[v]] iff the search for some
+                                vertex in the orbit of v has been started */
+    int *startlist,numstarted;
+    rootautom *autom;        /* automorphisms found at the root */
+    int numautom;
+    statsblk stats;          /* totals for the searches after v0 */
+    TracesStats tstats;      /* the same for Traces() */
+    int errstatus;
+    pthread_mutex_t mutex;
+} parsearch;
+
+static TLS_ATTR FILE *paroutfile;
+static TLS_ATTR boolean parmarkers;
+static TLS_ATTR void (*paruserlevelproc)
+             (int*,int*,int,int*,statsblk*,int,int,int,int,int,int);
+
+/*****************************************************************************
+*                                                                            *
+*  writeparmarker() writes a marker line in the same format as nauty().      *
+*                                                                            *
+*****************************************************************************/
+
+static void
+writeparmarker(FILE *f, int level, int tv, int index, int tcellsize,
+               int numorbits, int numcells)
+{
+    char s[30];
+
+#define PUTINT(i) itos(i,s); putstring(f,s)
+#define PUTSTR(x) putstring(f,x)
+
+    PUTSTR("level ");
+    PUTINT(level);
+    PUTSTR(":  ");
+    if (numcells != numorbits)
+    {
+        PUTINT(numcells);
+        PUTSTR(" cell");
+        if (numcells == 1) PUTSTR("; ");
+        else               PUTSTR("s; ");
+    }
+    PUTINT(numorbits);
+    PUTSTR(" orbit");
+    if (numorbits == 1) PUTSTR("; ");
+    else                PUTSTR("s; ");
+    PUTINT(tv+labelorg);
+    PUTSTR(" fixed; index ");
+    PUTINT(index);
+    if (tcellsize != index)
+    {
+        PUTSTR("/");
+        PUTINT(tcellsize);
+    }
+    PUTSTR("\n");
+}
+
+/*****************************************************************************
+*                                                                            *
+*  parlevel() is the userlevelproc for the search for v0.  Its levels are    *
+*  one more than those of nauty(), since v0 is already individualised.       *
+*                                                                            *
+*****************************************************************************/
+
+static void
+parlevel(int *lab, int *ptn, int level, int *orbits, statsblk *stats,
+         int tv, int index, int tcellsize, int numcells, int childcount,
+         int n)
+{
+    if (parmarkers && childcount > 0)
+        writeparmarker(paroutfile,level+1,tv,index,tcellsize,
+                       stats->numorbits,numcells);
+    if (paruserlevelproc)
+        (*paruserlevelproc)(lab,ptn,level+1,orbits,stats,tv,index,
+                            tcellsize,numcells,childcount,n);
+}
+
+/*****************************************************************************
+*                                                                            *
+*  shiftlevel(level) converts a level option for the whole search into       *
+*  the corresponding option for the searches below the root.                 *
+*                                                                            *
+*****************************************************************************/
+
+static int
+shiftlevel(int level)
+{
+    if (level > 0) return level - 1;
+    if (level < 0) return level + 1;
+    return 0;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  comparecanon_sg(g1,g2) compares two sparse graphs with the same number    *
+*  of vertices and sorted adjacency lists.  The value is -1, 0 or 1 as g1    *
+*  is less than, equal to or greater than g2 in an arbitrary total order.    *
+*                                                                            *
+*****************************************************************************/
+
+static int
+comparecanon_sg(sparsegraph *g1, sparsegraph *g2)
+{
+    int *d1,*e1,*d2,*e2;
+    int i,j,n;
+    size_t *v1,*v2;
+
+    SG_VDE(g1,v1,d1,e1);
+    SG_VDE(g2,v2,d2,e2);
+    n = g1->nv;
+
+    for (i = 0; i < n; ++i)
+    {
+        if (d1[i] != d2[i]) return (d1[i] < d2[i] ? -1 : 1);
+        for (j = 0; j < d1[i]; ++j)
+            if (e1[v1[i]+j] != e2[v2[i]+j])
+                return (e1[v1[i]+j] < e2[v2[i]+j] ? -1 : 1);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  childpartition() sets lab,ptn to the partition got from the root          *
+*  partition by individualising the vertex v of the target cell.             *
+*                                                                            *
+*****************************************************************************/
+
+static void
+childpartition(parsearch *ps, int v, int *lab, int *ptn)
+{
+    int i;
+
+    memcpy(lab,ps->rootlab,ps->n*sizeof(int));
+    memcpy(ptn,ps->rootptn,ps->n*sizeof(int));
+    for (i = ps->tc; lab[i] != v; ++i) {}
+    lab[i] = lab[ps->tc];
+    lab[ps->tc] = v;
+    ptn[ps->tc] = 0;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  searchchild() calls nauty() for the partition got by individualising      *
+*  the vertex v of the target cell.  tracessearchchild() calls Traces() for  *
+*  the graph g, which is ps->g or a copy of its header (Traces() writes to   *
+*  the header), and sorts the adjacency lists of the canonical graph.        *
+*                                                                            *
+*****************************************************************************/
+
+static void
+searchchild(parsearch *ps, optionblk *opts, int v, int *lab, int *ptn,
+            int *orbits, statsblk *stats, set *workspace, int worksize,
+            graph *canong)
+{
+    childpartition(ps,v,lab,ptn);
+    nauty(ps->g,lab,ptn,NULL,orbits,opts,stats,workspace,worksize,
+          ps->m,ps->n,canong);
+}
+
+static void
+tracessearchchild(parsearch *ps, sparsegraph *g, TracesOptions *opts, int v,
+                  int *lab, int *ptn, int *orbits, TracesStats *stats,
+                  sparsegraph *canong)
+{
+    childpartition(ps,v,lab,ptn);
+    Traces(g,lab,ptn,orbits,opts,stats,canong);
+    if (stats->errstatus == 0) sortlists_sg(canong);
+}
+
+/*****************************************************************************
+*                                                                            *
+*  markstarted() sets the started[] flags from the list of vertices whose    *
+*  searches have been started, after orbits[] has changed.                   *
+*                                                                            *
+*****************************************************************************/
+
+static void
+markstarted(parsearch *ps)
+{
+    int i;
+
+    for (i = 0; i < ps->n; ++i) ps->started[i] = FALSE;
+    for (i = 0; i < ps->numstarted; ++i)
+        ps->started[ps->orbits[ps->startlist[i]]] = TRUE;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  nextchild() returns the next vertex of the target cell to search, or -1   *
+*  if there are no more.  It must be called with the mutex locked.           *
+*                                                                            *
+*****************************************************************************/
+
+static int
+nextchild(parsearch *ps)
+{
+    int v;
+
+    while (ps->errstatus == 0 && ps->next < ps->cellsize)
+    {
+        v = ps->cell[ps->next++];
+        if (!ps->started[ps->orbits[v]])
+        {
+            ps->started[ps->orbits[v]] = TRUE;
+            ps->startlist[ps->numstarted++] = v;
+            return v;
+        }
+    }
+
+    return -1;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  rootautomfound() records the automorphism mapping v0 to v given by the    *
+*  canonical labelling lab with C(v) = C(v0).  It must be called with the    *
+*  mutex locked.                                                             *
+*                                                                            *
+*****************************************************************************/
+
+static void
+rootautomfound(parsearch *ps, int v, int *lab)
+{
+    int i,n;
+    int *p;
+
+    n = ps->n;
+    if ((p = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallel search");
+    for (i = 0; i < n; ++i) p[ps->lab0[i]] = lab[i];
+    ps->autom[ps->numautom].v = v;
+    ps->autom[ps->numautom].p = p;
+    ++ps->numautom;
+    orbjoin(ps->orbits,p,n);
+    markstarted(ps);
+}
+
+/*****************************************************************************
+*                                                                            *
+*  childdone() records the result of the search for v, which gave the        *
+*  canonical labelling lab.  It must be called with the mutex locked.        *
+*  tracesdone() does the same for Traces(), which gave the canonical         *
+*  graph canong.                                                             *
+*                                                                            *
+*****************************************************************************/
+
+static void
+childdone(parsearch *ps, int v, int *lab, statsblk *stats)
+{
+    int samerows;
+
+    ps->stats.numnodes += stats->numnodes;
+    ps->stats.numbadleaves += stats->numbadleaves;
+    ps->stats.tctotal += stats->tctotal;
+    ps->stats.canupdates += stats->canupdates;
+    if (stats->maxlevel > ps->stats.maxlevel)
+        ps->stats.maxlevel = stats->maxlevel;
+    if (stats->errstatus)
+    {
+        if (ps->errstatus == 0) ps->errstatus = stats->errstatus;
+        return;
+    }
+
+    if (ps->orbits[v] != ps->orbits[ps->cell[0]]
+        && (*ps->opts.dispatch->testcanlab)(ps->g,ps->canon0,lab,
+                                            &samerows,ps->m,ps->n) == 0)
+        rootautomfound(ps,v,lab);
+
+    if (ps->getcanon
+        && (*ps->opts.dispatch->testcanlab)(ps->g,ps->bestcanon,lab,
+                                            &samerows,ps->m,ps->n) < 0)
+    {
+        (*ps->opts.dispatch->updatecan)(ps->g,ps->bestcanon,lab,0,
+                                        ps->m,ps->n);
+        memcpy(ps->bestlab,lab,ps->n*sizeof(int));
+        ps->bestv = v;
+    }
+}
+
+static void
+tracesdone(parsearch *ps, int v, int *lab, sparsegraph *canong,
+           TracesStats *stats)
+{
+    ps->tstats.numnodes += stats->numnodes;
+    ps->tstats.interrupted += stats->interrupted;
+    ps->tstats.canupdates += stats->canupdates;
+    if (stats->peaknodes > ps->tstats.peaknodes)
+        ps->tstats.peaknodes = stats->peaknodes;
+    if (stats->treedepth > ps->tstats.treedepth)
+        ps->tstats.treedepth = stats->treedepth;
+    if (stats->errstatus)
+    {
+        if (ps->errstatus == 0) ps->errstatus = stats->errstatus;
+        return;
+    }
+
+    if (ps->orbits[v] != ps->orbits[ps->cell[0]]
+        && comparecanon_sg(canong,(sparsegraph*)ps->canon0) == 0)
+        rootautomfound(ps,v,lab);
+
+    if (ps->getcanon
+        && comparecanon_sg(canong,(sparsegraph*)ps->bestcanon) < 0)
+    {
+        copy_sg(canong,(sparsegraph*)ps->bestcanon);
+        memcpy(ps->bestlab,lab,ps->n*sizeof(int));
+        ps->bestv = v;
+    }
+}
+
+/*****************************************************************************
+*                                                                            *
+*  parworker() searches vertices of the target cell until there are none     *
+*  left.  It is run by each thread, including the calling thread.            *
+*                                                                            *
+*****************************************************************************/
+
+static void
+parworker(parsearch *ps)
+{
+    int *lab,*ptn,*orbits;
+    set *workspace;
+    graph *canong;
+    sparsegraph canong_sg,g_sg;
+    statsblk stats;
+    TracesStats tstats;
+    int v,n;
+
+    n = ps->n;
+    workspace = NULL;
+    if ((lab = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallel search");
+    if ((ptn = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallel search");
+    if ((orbits = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallel search");
+    if (!ps->traces && (workspace =
+                 (set*)ALLOCS(ps->worksize,sizeof(set))) == NULL)
+        alloc_error("parallel search");
+    if (ps->sparse)
+    {
+        SG_INIT(canong_sg);
+        canong = (graph*)&canong_sg;
+    }
+    else if ((canong = (graph*)ALLOCS((size_t)ps->m*n,sizeof(graph)))
+                                                                   == NULL)
+        alloc_error("parallel search");
+    if (ps->traces)
+    {
+        g_sg = *(sparsegraph*)ps->g;
+        g_sg.w = NULL;
+        g_sg.wlen = 0;
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&ps->mutex);
+        v = nextchild(ps);
+        pthread_mutex_unlock(&ps->mutex);
+        if (v < 0) break;
+
+        if (ps->traces)
+        {
+            tracessearchchild(ps,&g_sg,&ps->topts,v,lab,ptn,orbits,&tstats,
+                              &canong_sg);
+            pthread_mutex_lock(&ps->mutex);
+            tracesdone(ps,v,lab,&canong_sg,&tstats);
+            pthread_mutex_unlock(&ps->mutex);
+        }
+        else
+        {
+            searchchild(ps,&ps->opts,v,lab,ptn,orbits,&stats,
+                        workspace,ps->worksize,canong);
+            pthread_mutex_lock(&ps->mutex);
+            childdone(ps,v,lab,&stats);
+            pthread_mutex_unlock(&ps->mutex);
+        }
+    }
+
+    if (ps->sparse) SG_FREE(canong_sg);
+    else            FREES(canong);
+    if (workspace) FREES(workspace);
+    FREES(orbits);
+    FREES(ptn);
+    FREES(lab);
+}
+
+static void*
+parthread(void *arg)
+{
+    parworker((parsearch*)arg);
+
+    /* free the thread-local storage used by nauty in this thread */
+    nauty_freedyn();
+    nautil_freedyn();
+    naugraph_freedyn();
+    nausparse_freedyn();
+    schreier_freedyn();
+    if (((parsearch*)arg)->traces) traces_freedyn();
+
+    return NULL;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  initroot(ps,lab,ptn,defaultptn,inptn,numcells) sets ps->rootlab and       *
+*  ps->rootptn to the partition at the root given by lab,ptn or the unit     *
+*  partition, and inptn and numcells to the same partition in the form       *
+*  0/NAUTY_INFINITY.                                                         *
+*                                                                            *
+*****************************************************************************/
+
+static void
+initroot(parsearch *ps, int *lab, int *ptn, boolean defaultptn,
+         int *inptn, int *numcells)
+{
+    int i,n;
+
+    n = ps->n;
+    if (defaultptn)
+        for (i = 0; i < n; ++i)
+        {
+            ps->rootlab[i] = i;
+            inptn[i] = NAUTY_INFINITY;
+        }
+    else
+        for (i = 0; i < n; ++i)
+        {
+            ps->rootlab[i] = lab[i];
+            inptn[i] = (ptn[i] == 0 ? 0 : NAUTY_INFINITY);
+        }
+    inptn[n-1] = 0;
+    memcpy(ps->rootptn,inptn,n*sizeof(int));
+
+    *numcells = 0;
+    for (i = 0; i < n; ++i) if (inptn[i] == 0) ++*numcells;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  initcell() sets up the target cell, starting at ps->tc and of size        *
+*  ps->cellsize, and the other parts of ps used by the parallel search.      *
+*  ps->rootptn must have the form 0/NAUTY_INFINITY.                          *
+*                                                                            *
+*****************************************************************************/
+
+static void
+initcell(parsearch *ps)
+{
+    int i,j,n;
+
+    n = ps->n;
+    if ((ps->started = (boolean*)ALLOCS(n,sizeof(boolean))) == NULL
+        || (ps->cell = (int*)ALLOCS(ps->cellsize,sizeof(int))) == NULL
+        || (ps->startlist = (int*)ALLOCS(ps->cellsize,sizeof(int))) == NULL
+        || (ps->autom = (rootautom*)ALLOCS(ps->cellsize,sizeof(rootautom)))
+                                                                     == NULL
+        || (ps->orbits = (int*)ALLOCS(n,sizeof(int))) == NULL
+        || (ps->lab0 = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallel search");
+
+    for (i = 0; i < n; ++i) ps->started[i] = FALSE;
+    for (i = ps->tc; i < ps->tc + ps->cellsize; ++i)
+        ps->started[ps->rootlab[i]] = TRUE;
+    for (i = j = 0; i < n; ++i)
+        if (ps->started[i]) ps->cell[j++] = i;
+
+    ps->numautom = 0;
+    ps->numstarted = 0;
+    ps->next = ps->cellsize;
+    ps->getcanon = FALSE;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  runchildren() searches the vertices of the target cell other than v0,     *
+*  using at most nthreads threads, after the search for v0 gave the          *
+*  orbits orbits0 of its stabiliser.  If getcanon is TRUE, it keeps the      *
+*  least canonical graph found, starting with C(v0).                         *
+*                                                                            *
+*****************************************************************************/
+
+static void
+runchildren(parsearch *ps, int *orbits0, boolean getcanon, int nthreads)
+{
+    pthread_t *threads;
+    pthread_attr_t attr;
+    rootautom ra;
+    int i,j,n,numthreads,numstarted;
+
+    n = ps->n;
+    memcpy(ps->orbits,orbits0,n*sizeof(int));
+    ps->startlist[0] = ps->cell[0];
+    ps->numstarted = 1;
+    markstarted(ps);
+    ps->next = 1;
+
+    ps->getcanon = getcanon;
+    if (getcanon)
+    {
+        ps->bestv = ps->cell[0];
+        if ((ps->bestlab = (int*)ALLOCS(n,sizeof(int))) == NULL)
+            alloc_error("parallel search");
+        memcpy(ps->bestlab,ps->lab0,n*sizeof(int));
+        if (ps->sparse)
+            ps->bestcanon = (graph*)copy_sg((sparsegraph*)ps->canon0,NULL);
+        else
+        {
+            if ((ps->bestcanon =
+                 (graph*)ALLOCS((size_t)ps->m*n,sizeof(graph))) == NULL)
+                alloc_error("parallel search");
+            memcpy(ps->bestcanon,ps->canon0,
+                   (size_t)ps->m*n*sizeof(graph));
+        }
+    }
+
+    numthreads = (nthreads < ps->cellsize-1 ? nthreads : ps->cellsize-1);
+    if ((threads = (pthread_t*)ALLOCS(numthreads,sizeof(pthread_t))) == NULL)
+        alloc_error("parallel search");
+    pthread_mutex_init(&ps->mutex,NULL);
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr,STACKSIZE);
+    for (numstarted = 0; numstarted < numthreads-1; ++numstarted)
+        if (pthread_create(&threads[numstarted],&attr,parthread,ps) != 0)
+            break;
+    parworker(ps);
+    for (i = 0; i < numstarted; ++i) pthread_join(threads[i],NULL);
+    pthread_attr_destroy(&attr);
+    pthread_mutex_destroy(&ps->mutex);
+    FREES(threads);
+
+    /* put the automorphisms found at the root in order of v */
+
+    for (i = 1; i < ps->numautom; ++i)
+    {
+        ra = ps->autom[i];
+        for (j = i; j > 0 && ps->autom[j-1].v > ra.v; --j)
+            ps->autom[j] = ps->autom[j-1];
+        ps->autom[j] = ra;
+    }
+}
+
+/*****************************************************************************
+*                                                                            *
+*  rootindex(ps,orbits) returns the number of vertices of the target cell    *
+*  in the orbit of v0.                                                       *
+*                                                                            *
+*****************************************************************************/
+
+static int
+rootindex(parsearch *ps, int *orbits)
+{
+    int i,index;
+
+    index = 0;
+    for (i = 0; i < ps->cellsize; ++i)
+        if (orbits[ps->cell[i]] == orbits[ps->cell[0]]) ++index;
+
+    return index;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  freesearch() frees what initcell() and runchildren() allocated.           *
+*                                                                            *
+*****************************************************************************/
+
+static void
+freesearch(parsearch *ps)
+{
+    int i;
+
+    for (i = 0; i < ps->numautom; ++i) FREES(ps->autom[i].p);
+    if (ps->getcanon)
+    {
+        if (ps->sparse)
+        {
+            SG_FREE(*(sparsegraph*)ps->bestcanon);
+            FREES(ps->bestcanon);
+        }
+        else
+            FREES(ps->bestcanon);
+        FREES(ps->bestlab);
+    }
+    FREES(ps->lab0);
+    FREES(ps->orbits);
+    FREES(ps->autom);
+    FREES(ps->startlist);
+    FREES(ps->cell);
+    FREES(ps->started);
+}
+
+#endif  /* PARALLEL_OK */
+
+/*****************************************************************************
+*                                                                            *
+*  parallelnauty_available() returns TRUE if parallelnauty() and             *
+*  parallelTraces() can use more than one thread.                            *
+*                                                                            *
+*****************************************************************************/
+
+boolean
+parallelnauty_available(void)
+{
+    return PARALLEL_OK;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  parallelnauty(g,lab,ptn,active,orbits,options,stats,workspace,worksize,   *
+*                nthreads,m,n,canong)                                        *
+*  The parameters are as for nauty(), with nthreads the maximum number of    *
+*  threads to use.  See the top of this file for the differences.            *
+*                                                                            *
+*****************************************************************************/
+
+void
+parallelnauty(graph *g, int *lab, int *ptn, set *active, int *orbits,
+              optionblk *options, statsblk *stats, set *workspace,
+              int worksize, int nthreads, int m, int n, graph *canong)
+{
+#if PARALLEL_OK
+    parsearch ps;
+    optionblk opts0;
+    statsblk stats0;
+    dispatchvec *disp;
+    void (*refproc)(graph*,int*,int*,int,int*,int*,set*,int*,int,int);
+    int *inptn,*invar,*ptn0;
+    set *act;
+    sparsegraph canon0_sg;
+    int i,j,numcells,qinvar,code,index,numorbits;
+    boolean localcanon;
+#endif
+
+    if (!PARALLEL_OK || nthreads <= 1 || n <= 2 || options->dispatch == NULL)
+    {
+        nauty(g,lab,ptn,active,orbits,options,stats,workspace,worksize,
+              m,n,canong);
+        return;
+    }
+
+#if PARALLEL_OK
+    disp = options->dispatch;
+    if (options->userrefproc)
+        refproc = options->userrefproc;
+    else if (disp->refine1 && m == 1)
+        refproc = disp->refine1;
+    else
+        refproc = disp->refine;
+
+    ps.g = g;
+    ps.m = m;
+    ps.n = n;
+    ps.sparse = (disp == &dispatch_sparse);
+    ps.traces = FALSE;
+    ps.worksize = (worksize >= 2*m ? worksize : 2*m);
+
+    if ((ps.rootlab = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelnauty");
+    if ((ps.rootptn = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelnauty");
+    if ((inptn = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelnauty");
+    if ((invar = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelnauty");
+    if ((act = (set*)ALLOCS(m,sizeof(set))) == NULL)
+        alloc_error("parallelnauty");
+
+    /* set up and refine the partition at the root, as nauty() does */
+
+    initroot(&ps,lab,ptn,options->defaultptn,inptn,&numcells);
+    if (active != NULL && !options->defaultptn)
+        for (i = 0; i < m; ++i) act[i] = active[i];
+    else
+    {
+        EMPTYSET(act,m);
+        for (i = 0; i < n; ++i)
+        {
+            ADDELEMENT(act,i);
+            while (inptn[i]) ++i;
+        }
+    }
+
+    doref(g,ps.rootlab,ps.rootptn,1,&numcells,&qinvar,invar,act,&code,
+          refproc,options->invarproc,options->mininvarlevel,
+          options->maxinvarlevel,options->invararg,options->digraph,m,n);
+    FREES(act);
+    FREES(invar);
+
+    if (numcells == n)    /* nothing to divide */
+    {
+        FREES(inptn);
+        FREES(ps.rootptn);
+        FREES(ps.rootlab);
+        nauty(g,lab,ptn,active,orbits,options,stats,workspace,worksize,
+              m,n,canong);
+        return;
+    }
+
+    ps.tc = (*disp->targetcell)(g,ps.rootlab,ps.rootptn,1,
+               (options->digraph ? 0 : options->tc_level),
+               options->digraph,-1,m,n);
+    for (j = ps.tc; ps.rootptn[j] > 1; ++j) {}
+    ps.cellsize = j - ps.tc + 1;
+    for (i = 0; i < n; ++i)
+        ps.rootptn[i] = (ps.rootptn[i] <= 1 ? 0 : NAUTY_INFINITY);
+
+    initcell(&ps);
+    if ((ptn0 = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelnauty");
+
+    /* options for the searches below the root */
+
+    ps.opts = *options;
+    ps.opts.getcanon = TRUE;
+    ps.opts.defaultptn = FALSE;
+    ps.opts.writeautoms = FALSE;
+    ps.opts.writemarkers = FALSE;
+    ps.opts.userautomproc = NULL;
+    ps.opts.userlevelproc = NULL;
+    ps.opts.usernodeproc = NULL;
+    ps.opts.usercanonproc = NULL;
+    ps.opts.tc_level = shiftlevel(options->tc_level);
+    ps.opts.mininvarlevel = shiftlevel(options->mininvarlevel);
+    ps.opts.maxinvarlevel = shiftlevel(options->maxinvarlevel);
+
+    /* first the search for v0 in this thread, with output */
+
+    opts0 = ps.opts;
+    opts0.writeautoms = options->writeautoms;
+    opts0.userautomproc = options->userautomproc;
+    paroutfile = (options->outfile == NULL ? stdout : options->outfile);
+    parmarkers = options->writemarkers;
+    paruserlevelproc = options->userlevelproc;
+    if (parmarkers || paruserlevelproc) opts0.userlevelproc = parlevel;
+
+    localcanon = !(options->getcanon && canong != NULL);
+    if (!localcanon)
+        ps.canon0 = canong;
+    else if (ps.sparse)
+    {
+        SG_INIT(canon0_sg);
+        ps.canon0 = (graph*)&canon0_sg;
+    }
+    else if ((ps.canon0 = (graph*)ALLOCS((size_t)m*n,sizeof(graph)))
+                                                                   == NULL)
+        alloc_error("parallelnauty");
+
+    searchchild(&ps,&opts0,ps.cell[0],ps.lab0,ptn0,orbits,&stats0,
+                workspace,worksize,ps.canon0);
+
+    ps.errstatus = stats0.errstatus;
+    ps.stats.numnodes = ps.stats.numbadleaves = 0;
+    ps.stats.tctotal = ps.stats.canupdates = 0;
+    ps.stats.maxlevel = 0;
+
+    /* now the other vertices of the target cell, in parallel */
+
+    if (ps.errstatus == 0)
+        runchildren(&ps,orbits,options->getcanon,nthreads);
+
+    numorbits = stats0.numorbits;
+    for (i = 0; i < ps.numautom; ++i)
+    {
+        numorbits = orbjoin(orbits,ps.autom[i].p,n);
+        if (options->writeautoms)
+            writeperm(paroutfile,ps.autom[i].p,options->cartesian,
+                      options->linelength,n);
+        OPTCALL(options->userautomproc)(stats0.numgenerators+i+1,
+                       ps.autom[i].p,orbits,numorbits,ps.cell[0],n);
+    }
+    index = rootindex(&ps,orbits);
+
+    *stats = stats0;
+    MULTIPLY(stats->grpsize1,stats->grpsize2,index);
+    stats->numorbits = numorbits;
+    stats->numgenerators += ps.numautom;
+    stats->numnodes += ps.stats.numnodes + 1;
+    stats->numbadleaves += ps.stats.numbadleaves;
+    if (ps.stats.maxlevel > stats->maxlevel)
+        stats->maxlevel = ps.stats.maxlevel;
+    ++stats->maxlevel;
+    stats->tctotal += ps.stats.tctotal + ps.cellsize;
+    stats->canupdates += ps.stats.canupdates;
+    stats->errstatus = ps.errstatus;
+
+    if (stats->errstatus == 0)
+    {
+        if (options->writemarkers)
+            writeparmarker(paroutfile,1,ps.cell[0],index,ps.cellsize,
+                           numorbits,numcells);
+        OPTCALL(options->userlevelproc)(ps.rootlab,ps.rootptn,1,orbits,
+                  stats,ps.cell[0],index,ps.cellsize,numcells,
+                  ps.numstarted,n);
+    }
+
+    /* the result */
+
+    if (ps.getcanon && stats->errstatus == 0)
+    {
+        if (ps.bestv != ps.cell[0])
+        {
+            (*disp->updatecan)(g,canong,ps.bestlab,0,m,n);
+            if (ps.sparse) sortlists_sg((sparsegraph*)canong);
+        }
+        memcpy(lab,ps.bestlab,n*sizeof(int));
+    }
+    else
+        memcpy(lab,ps.lab0,n*sizeof(int));
+    memcpy(ptn,inptn,n*sizeof(int));
+
+    if (localcanon)
+    {
+        if (ps.sparse) SG_FREE(canon0_sg);
+        else           FREES(ps.canon0);
+    }
+    freesearch(&ps);
+    FREES(ptn0);
+    FREES(inptn);
+    FREES(ps.rootptn);
+    FREES(ps.rootlab);
+#endif
+}
+
+/*****************************************************************************
+*                                                                            *
+*  parallelTraces(g,lab,ptn,orbits,options,stats,nthreads,canong)            *
+*  The parameters are as for Traces(), with nthreads the maximum number of   *
+*  threads to use.  See the top of this file for the differences.            *
+*                                                                            *
+*****************************************************************************/
+
+void
+parallelTraces(sparsegraph *g, int *lab, int *ptn, int *orbits,
+               TracesOptions *options, TracesStats *stats, int nthreads,
+               sparsegraph *canong)
+{
+#if PARALLEL_OK
+    parsearch ps;
+    TracesOptions opts0;
+    TracesStats stats0;
+    int *inptn,*count,*ptn0;
+    set *act;
+    sparsegraph canon0_sg;
+    FILE *outfile;
+    int i,j,m,n,numcells,code,index,numorbits;
+    boolean localcanon;
+#endif
+
+    if (!PARALLEL_OK || nthreads <= 1 || g->nv <= 2 || options->weighted
+        || (options->generators != NULL && *options->generators != NULL))
+    {
+        Traces(g,lab,ptn,orbits,options,stats,canong);
+        return;
+    }
+
+#if PARALLEL_OK
+    n = g->nv;
+    m = SETWORDSNEEDED(n);
+
+    ps.g = (graph*)g;
+    ps.m = m;
+    ps.n = n;
+    ps.sparse = TRUE;
+    ps.traces = TRUE;
+
+    if ((ps.rootlab = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelTraces");
+    if ((ps.rootptn = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelTraces");
+    if ((inptn = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelTraces");
+    if ((count = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelTraces");
+    if ((act = (set*)ALLOCS(m,sizeof(set))) == NULL)
+        alloc_error("parallelTraces");
+
+    /* set up and refine the partition at the root */
+
+    initroot(&ps,lab,ptn,options->defaultptn,inptn,&numcells);
+    EMPTYSET(act,m);
+    for (i = 0; i < n; ++i)
+    {
+        ADDELEMENT(act,i);
+        while (inptn[i]) ++i;
+    }
+    refine_sg((graph*)g,ps.rootlab,ps.rootptn,0,&numcells,count,act,&code,
+              m,n);
+    FREES(act);
+    FREES(count);
+
+    /* the target cell is the first largest one */
+
+    ps.cellsize = 1;
+    for (i = 0; i < n; i = j + 1)
+    {
+        for (j = i; ps.rootptn[j] != 0; ++j) {}
+        if (j - i + 1 > ps.cellsize)
+        {
+            ps.tc = i;
+            ps.cellsize = j - i + 1;
+        }
+    }
+
+    if (ps.cellsize == 1)    /* nothing to divide */
+    {
+        FREES(inptn);
+        FREES(ps.rootptn);
+        FREES(ps.rootlab);
+        Traces(g,lab,ptn,orbits,options,stats,canong);
+        return;
+    }
+
+    initcell(&ps);
+    if ((ptn0 = (int*)ALLOCS(n,sizeof(int))) == NULL)
+        alloc_error("parallelTraces");
+
+    /* options for the searches below the root */
+
+    ps.topts = *options;
+    ps.topts.getcanon = TRUE;
+    ps.topts.defaultptn = FALSE;
+    ps.topts.writeautoms = FALSE;
+    ps.topts.verbosity = 0;
+    ps.topts.generators = NULL;
+    ps.topts.userautomproc = NULL;
+    ps.topts.usercanonproc = NULL;
+
+    /* first the search for v0 in this thread, with output */
+
+    opts0 = ps.topts;
+    opts0.writeautoms = options->writeautoms;
+    opts0.verbosity = options->verbosity;
+    opts0.generators = options->generators;
+    opts0.userautomproc = options->userautomproc;
+    outfile = (options->outfile == NULL ? stdout : options->outfile);
+
+    localcanon = !(options->getcanon && canong != NULL);
+    if (!localcanon)
+        ps.canon0 = (graph*)canong;
+    else
+    {
+        SG_INIT(canon0_sg);
+        ps.canon0 = (graph*)&canon0_sg;
+    }
+
+    tracessearchchild(&ps,g,&opts0,ps.cell[0],ps.lab0,ptn0,orbits,&stats0,
+                      (sparsegraph*)ps.canon0);
+
+    ps.errstatus = stats0.errstatus;
+    ps.tstats.numnodes = ps.tstats.interrupted = ps.tstats.peaknodes = 0;
+    ps.tstats.canupdates = ps.tstats.treedepth = 0;
+
+    /* now the other vertices of the target cell, in parallel */
+
+    if (ps.errstatus == 0)
+        runchildren(&ps,orbits,options->getcanon,nthreads);
+
+    numorbits = stats0.numorbits;
+    for (i = 0; i < ps.numautom; ++i)
+    {
+        numorbits = orbjoin(orbits,ps.autom[i].p,n);
+        if (options->generators)
+            addpermutation(options->generators,ps.autom[i].p,n);
+        if (options->writeautoms)
+        {
+            fprintf(outfile,"Gen #%d: ",stats0.numgenerators+i+1);
+            writeperm(outfile,ps.autom[i].p,options->cartesian,
+                      options->linelength,n);
+        }
+        OPTCALL(options->userautomproc)(stats0.numgenerators+i+1,
+                                        ps.autom[i].p,n);
+    }
+    index = rootindex(&ps,orbits);
+
+    *stats = stats0;
+    MULTIPLY(stats->grpsize1,stats->grpsize2,index);
+    stats->numorbits = numorbits;
+    stats->numgenerators += ps.numautom;
+    stats->numnodes += ps.tstats.numnodes + 1;
+    stats->interrupted += ps.tstats.interrupted;
+    if (ps.tstats.peaknodes > stats->peaknodes)
+        stats->peaknodes = ps.tstats.peaknodes;
+    if (ps.tstats.treedepth > stats->treedepth)
+        stats->treedepth = ps.tstats.treedepth;
+    ++stats->treedepth;
+    stats->canupdates += ps.tstats.canupdates;
+    stats->errstatus = ps.errstatus;
+
+    /* the result */
+
+    if (ps.getcanon && stats->errstatus == 0)
+    {
+        if (ps.bestv != ps.cell[0])
+            copy_sg((sparsegraph*)ps.bestcanon,canong);
+        memcpy(lab,ps.bestlab,n*sizeof(int));
+    }
+    else
+        memcpy(lab,ps.lab0,n*sizeof(int));
+    memcpy(ptn,inptn,n*sizeof(int));
+
+    if (localcanon) SG_FREE(canon0_sg);
+    freesearch(&ps);
+    FREES(ptn0);
+    FREES(inptn);
+    FREES(ps.rootptn);
+    FREES(ps.rootlab);
+#endif
+}
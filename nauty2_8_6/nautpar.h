@@ -0,0 +1,34 @@
+/* nautpar.h - Parallel search at the top level of nauty and Traces.
+ *
+ * The procedures declared here only use more than one thread if nauty
+ * has been configured with --enable-tls and linked with the Posix
+ * threads library.  Otherwise they behave like a call to nauty() or
+ * Traces().
+ *
+ * parallelTraces() is not a speedup: each vertex of the target cell starts
+ * a full call to Traces(), which forgoes the pruning Traces does at the
+ * root, so it does much more work than one call to Traces() on symmetric
+ * and rigid graphs alike.
+ */
+
+#ifndef  _NAUTPAR_H_    /* only process this file once */
+#define  _NAUTPAR_H_
+
+#include "nauty.h"
+#include "traces.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern boolean parallelnauty_available(void);
+extern void parallelnauty(graph*,int*,int*,set*,int*,optionblk*,
+                          statsblk*,set*,int,int,int,int,graph*);
+extern void parallelTraces(sparsegraph*,int*,int*,int*,TracesOptions*,
+                           TracesStats*,int,sparsegraph*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _NAUTPAR_H_ */
@@ -33,14 +33,65 @@ static TLS_ATTR set workset2[MAXM];
 static TLS_ATTR schreier *schreier_freelist = NULL;
         /* Freelist of scheier structures connected by next field.
          * vec, pwr and orbits fields are assumed allocated. */
-static TLS_ATTR permnode *permnode_freelist = NULL;
-        /* Freelist of permnode structures connected by next field.
-         * p[] is assumed extended. */
+
+/* Permnodes are not allocated one at a time, but carved out of blocks
+ * of PERMBLOCKMAX nodes of the same size, or fewer if n is large, so
+ * that the permutations of a group are close together in memory.
+ * Each node is preceded by a pointer to its block, and each block has
+ * its own freelist.  The blocks with at least one free node are kept
+ * in permblock_avail, and a block is freed as soon as all its nodes
+ * are free.  The blocks are thread-local, so a permnode must be freed
+ * by the thread which allocated it. */
+
+typedef struct permblockstruct
+{
+    struct permblockstruct *next,*prev;  /* in permblock_avail */
+    permnode *freelist;          /* free nodes, connected by next field */
+    int nalloc;                  /* size of p[] in each node */
+    int nnodes;                  /* number of nodes in the block */
+    int nfree;                   /* number of nodes in freelist */
+} permblock;
+
+typedef union
+{
+    permblock *blk;              /* the block holding the following node */
+    unsigned long align1;
+    double align2;
+} permnodehead;
+
+#define PERMBLOCKOF(p) (((permnodehead*)(p)-1)->blk)
+#define ROUNDUP(x,k) (((x) + (k) - 1) / (k) * (k))
+
+#define PERMBLOCKMAX 64          /* maximum number of nodes in a block */
+#define PERMBLOCKINTS 65536      /* aim for at most this many ints */
+#if FLEX_ARRAY_OK
+#define PERMNODESIZE(n) (sizeof(permnode)+(size_t)(n)*sizeof(int))
+#else
+#define PERMNODESIZE(n) (sizeof(permnode)+(size_t)((n)>2?(n)-2:0)*sizeof(int))
+#endif
+
+static TLS_ATTR permblock *permblock_avail = NULL;
+        /* Doubly-linked list of the blocks with nfree > 0. */
 
 static TLS_ATTR int schreierfails = SCHREIERFAILS;
 
 #define TMP
 
+/* On x86-64 with gcc or clang, permutations are composed with the AVX2
+   gather instruction if the CPU supports it, even if nauty was compiled
+   for a generic target.  Define NAUTY_NO_SIMD to prevent this. */
+
+#if defined(__x86_64__) && !defined(NAUTY_NO_SIMD) \
+    && ((defined(__clang__) && __clang_major__ >= 10) \
+        || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define SIMDPERM 1
+#include <immintrin.h>
+#define SIMDMINN 16     /* smallest n for which the kernel is used */
+static TLS_ATTR boolean (*composeperm)(int*,int*,int,int) = NULL;
+#else
+#define SIMDPERM 0
+#endif
+
 static boolean filterschreier(schreier*,int*,permnode**,boolean,int,int);
 #define PNCODE(x) ((int)(((size_t)(x)>>3)&0xFFFUL))
 
@@ -104,12 +155,35 @@ schreier_fails(int nfails)
 
 /************************************************************************/
 
+static void
+unlinkpermblock(permblock *blk)
+/* Remove blk from permblock_avail. */
+{
+    if (blk->prev) blk->prev->next = blk->next;
+    else           permblock_avail = blk->next;
+    if (blk->next) blk->next->prev = blk->prev;
+}
+
+/************************************************************************/
+
+static void
+linkpermblock(permblock *blk)
+/* Put blk at the front of permblock_avail. */
+{
+    blk->prev = NULL;
+    blk->next = permblock_avail;
+    if (permblock_avail) permblock_avail->prev = blk;
+    permblock_avail = blk;
+}
+
+/************************************************************************/
+
 static void
 clearfreelists(void)
-/* Clear the schreier and permnode freelists */
+/* Clear the schreier freelist.  The permnode blocks don't need it,
+ * as each of them is freed once none of its nodes is in use. */
 {
     schreier *sh,*nextsh;
-    permnode *p,*nextp;
 
     nextsh = schreier_freelist;
     while (nextsh)
@@ -122,15 +196,29 @@ clearfreelists(void)
         free(sh);
     }
     schreier_freelist = NULL;
+}
+
+/************************************************************************/
 
-    nextp = permnode_freelist;
-    while (nextp)
+static void
+releasepermnode(permnode *p)
+/* Return p to the freelist of its block, and free the block if none
+ * of its nodes is in use any more. */
+{
+    permblock *blk;
+
+    blk = PERMBLOCKOF(p);
+
+    if (blk->nfree == blk->nnodes - 1)
     {
-        p = nextp;
-        nextp = p->next;
-        free(p);
+        if (blk->nfree > 0) unlinkpermblock(blk);
+        free(blk);
+        return;
     }
-    permnode_freelist = NULL;
+
+    p->next = blk->freelist;
+    blk->freelist = p;
+    if (blk->nfree++ == 0) linkpermblock(blk);
 }
 
 /************************************************************************/
@@ -140,35 +228,54 @@ static permnode
 /* Allocate a new permode structure, with initialized next/prev fields */
 {
     permnode *p;
+    permblock *blk;
+    size_t headsize,nodesize;
+    int i,nnodes;
+
+    for (blk = permblock_avail; blk; blk = blk->next)
+        if (blk->nalloc >= n && blk->nalloc <= n+100) break;
 
-    while (permnode_freelist)
+    if (!blk)
     {
-        p = permnode_freelist;
-        permnode_freelist = p->next;
-        if (p->nalloc >= n && p->nalloc <= n+100)
+        headsize = ROUNDUP(sizeof(permblock),sizeof(permnodehead));
+        nodesize = ROUNDUP(sizeof(permnodehead)+PERMNODESIZE(n),
+                           sizeof(permnodehead));
+        nnodes = PERMBLOCKINTS / (n > 0 ? n : 1);
+        if (nnodes > PERMBLOCKMAX) nnodes = PERMBLOCKMAX;
+        if (nnodes < 1) nnodes = 1;
+
+        blk = (permblock*) malloc(headsize + nnodes*nodesize);
+
+        if (blk == NULL)
         {
-            p->next = p->prev = NULL;
-            p->mark = 0;
-            return p;
+            fprintf(ERRFILE,">E malloc failed in newpermnode()\n");
+            exit(1);
         }
-        else
-            free(p);
-    }
 
-#if FLEX_ARRAY_OK
-    p = (permnode*) malloc(sizeof(permnode)+n*sizeof(int)); 
-#else
-    p = (permnode*) malloc(sizeof(permnode)+(n-2)*sizeof(int)); 
-#endif
+        blk->nalloc = n;
+        blk->nnodes = blk->nfree = nnodes;
+        blk->freelist = NULL;
 
-    if (p == NULL)
-    {
-        fprintf(ERRFILE,">E malloc failed in newpermnode()\n");
-        exit(1);
+      /* Put the nodes onto the block's freelist, in order. */
+
+        for (i = nnodes; --i >= 0; )
+        {
+            p = (permnode*)((char*)blk + headsize + i*nodesize
+                                       + sizeof(permnodehead));
+            PERMBLOCKOF(p) = blk;
+            p->nalloc = n;
+            p->next = blk->freelist;
+            blk->freelist = p;
+        }
+        linkpermblock(blk);
     }
 
+    p = blk->freelist;
+    blk->freelist = p->next;
+    if (--blk->nfree == 0) unlinkpermblock(blk);
+
     p->next = p->prev = NULL;
-    p->nalloc = n;
+    p->mark = 0;
 
     return p;
 }
@@ -252,8 +359,7 @@ freeschreier(schreier **gp, permnode **gens)
         do
         {
             nextp = p->next;
-            p->next = permnode_freelist;
-            permnode_freelist = p;
+            releasepermnode(p);
             p = nextp;
         } while (p != *gens);
         *gens = NULL;
@@ -375,8 +481,7 @@ delpermnode(permnode **ring)
         (*ring)->prev->next = newring;
     }
 
-    (*ring)->next = permnode_freelist;
-    permnode_freelist = *ring;
+    releasepermnode(*ring);
 
     *ring = newring;
 }
@@ -460,9 +565,92 @@ newgroup(schreier **sh, permnode **ring, int n)
 
 /************************************************************************/
 
-static void
+static boolean
+composeperm_generic(int *wp, int *p, int k, int n)
+/* Replace each wp[i] by the image of wp[i] under p^k, where k >= 1.
+ * Return FALSE if wp is then the identity, otherwise TRUE. */
+{
+    int i,j,x,moved;
+
+    moved = 0;
+    if (k == 1)
+        for (i = 0; i < n; ++i)
+        {
+            x = p[wp[i]];
+            wp[i] = x;
+            moved |= x ^ i;
+        }
+    else
+        for (i = 0; i < n; ++i)
+        {
+            x = p[wp[i]];
+            for (j = k; --j > 0; ) x = p[x];
+            wp[i] = x;
+            moved |= x ^ i;
+        }
+
+    return moved != 0;
+}
+
+#if SIMDPERM
+/************************************************************************/
+
+__attribute__((target("avx2")))
+static boolean
+composeperm_avx2(int *wp, int *p, int k, int n)
+/* Same as composeperm_generic(), eight entries of wp at a time */
+{
+    const __m256i eight = _mm256_set1_epi32(8);
+    __m256i v,id,acc;
+    int i,j,x,moved;
+
+    id = _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+    acc = _mm256_setzero_si256();
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        v = _mm256_loadu_si256((__m256i*)(wp+i));
+        for (j = 0; j < k; ++j) v = _mm256_i32gather_epi32(p,v,4);
+        _mm256_storeu_si256((__m256i*)(wp+i),v);
+        acc = _mm256_or_si256(acc,_mm256_xor_si256(v,id));
+        id = _mm256_add_epi32(id,eight);
+    }
+
+    moved = 0;
+    for ( ; i < n; ++i)
+    {
+        x = p[wp[i]];
+        for (j = k; --j > 0; ) x = p[x];
+        wp[i] = x;
+        moved |= x ^ i;
+    }
+
+    return moved != 0 || !_mm256_testz_si256(acc,acc);
+}
+
+static boolean
+(*choosecomposeperm(void))(int*,int*,int,int)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return composeperm_avx2;
+    return composeperm_generic;
+}
+
+    /* COMPOSEPERM(wp,p,k,n) is composeperm_generic(wp,p,k,n) done with
+       the best kernel available. */
+#define COMPOSEPERM(wp,p,k,n) \
+    ((n) < SIMDMINN ? composeperm_generic(wp,p,k,n) \
+     : ((composeperm == NULL ? (composeperm = choosecomposeperm()) : NULL), \
+        (*composeperm)(wp,p,k,n)))
+#else
+#define COMPOSEPERM(wp,p,k,n) composeperm_generic(wp,p,k,n)
+#endif
+
+/************************************************************************/
+
+static boolean
 applyperm(int *wp, int *p, int k, int n)
-/* Apply the permutation p, k times to each element of wp */
+/* Apply the permutation p, k times to each element of wp.
+ * Return FALSE if wp is then the identity, otherwise TRUE. */
 {
     int i,j,cyclen,kk,m;
 
@@ -471,17 +659,11 @@ applyperm(int *wp, int *p, int k, int n)
     if (k <= 5)
     {
         if (k == 0)
-            return;
-        else if (k == 1)
-            for (i = 0; i < n; ++i) wp[i] = p[wp[i]];
-        else if (k == 2)
-            for (i = 0; i < n; ++i) wp[i] = p[p[wp[i]]];
-        else if (k == 3)
-            for (i = 0; i < n; ++i) wp[i] = p[p[p[wp[i]]]];
-        else if (k == 4)
-            for (i = 0; i < n; ++i) wp[i] = p[p[p[p[wp[i]]]]];
-        else if (k == 5)
-            for (i = 0; i < n; ++i) wp[i] = p[p[p[p[p[wp[i]]]]]];
+        {
+            for (i = 0; i < n; ++i) if (wp[i] != i) break;
+            return i < n;
+        }
+        return COMPOSEPERM(wp,p,k,n);
     }
     else if (k <= 19)
     {
@@ -489,18 +671,9 @@ applyperm(int *wp, int *p, int k, int n)
         DYNALLOC1(int,workpermA,workpermA_sz,n,"applyperm");
 #endif
         for (i = 0; i < n; ++i) workpermA[i] = p[p[p[i]]];
-        for (; k >= 6; k -= 6)
-            for (i = 0; i < n; ++i) wp[i] = workpermA[workpermA[wp[i]]];
-        if (k == 1)
-            for (i = 0; i < n; ++i) wp[i] = p[wp[i]];
-        else if (k == 2)
-            for (i = 0; i < n; ++i) wp[i] = p[p[wp[i]]];
-        else if (k == 3)
-            for (i = 0; i < n; ++i) wp[i] = workpermA[wp[i]];
-        else if (k == 4)
-            for (i = 0; i < n; ++i) wp[i] = p[workpermA[wp[i]]];
-        else if (k == 5)
-            for (i = 0; i < n; ++i) wp[i] = p[p[workpermA[wp[i]]]];
+        if (k % 3 == 0) return COMPOSEPERM(wp,workpermA,k/3,n);
+        COMPOSEPERM(wp,workpermA,k/3,n);
+        return COMPOSEPERM(wp,p,k%3,n);
     }
     else
     {
@@ -537,7 +710,7 @@ applyperm(int *wp, int *p, int k, int n)
                 }
             }
         }
-        for (i = 0; i < n; ++i) wp[i] = workpermB[wp[i]];
+        return COMPOSEPERM(wp,workpermB,1,n);
     }
 }
 
@@ -580,13 +753,15 @@ filterschreier(schreier *gp, int *p, permnode **ring,
     sh = gp;
     changed = FALSE;
     if (maxlevel < 0) maxlevel = n+1;
+
+    for (i = 0; i < n; ++i) if (workperm[i] != i) break;
+    ident = (i == n);
+
+  /* ident is kept up to date by applyperm(), so the remaining levels
+     are skipped as soon as workperm becomes the identity. */
  
-    for (lev = 0; lev <= maxlevel; ++lev)
+    for (lev = 0; !ident && lev <= maxlevel; ++lev)
     {
-        for (i = 0; i < n; ++i) if (workperm[i] != i) break;
-        ident = (i == n);
-        if (ident) break;
-
         lchanged = FALSE;
         orbits = sh->orbits;
         vec = sh->vec;
@@ -638,7 +813,7 @@ filterschreier(schreier *gp, int *p, permnode **ring,
 
             while (j != sh->fixed)
             {
-                applyperm(workperm,vec[j]->p,pwr[j],n);
+                ident = !applyperm(workperm,vec[j]->p,pwr[j],n);
                 ++multcount;
                 curr = NULL;
                 j = workperm[sh->fixed];
@@ -665,7 +840,7 @@ expandschreier(schreier *gp, permnode **ring, int n)
 /* filter random elements until schreierfails failures.
  * Return true if it ever expanded. */
 {
-    int i,j,nfails,wordlen,skips;
+    int j,nfails,wordlen,skips;
     boolean changed;
     permnode *pn;
 #if !MAXN
@@ -688,7 +863,7 @@ expandschreier(schreier *gp, permnode **ring, int n)
         for (j = 0; j < wordlen; ++j)
         {
             for (skips = KRAN(17); --skips >= 0; ) pn = pn->next;
-            for (i = 0; i < n; ++i) workperm2[i] = pn->p[workperm2[i]];
+            COMPOSEPERM(workperm2,pn->p,1,n);
         }
         if (filterschreier(gp,workperm2,ring,TRUE,-1,n))
         {
@@ -774,7 +949,7 @@ getorbitsmin(int *fix, int nfix, schreier *gp, permnode **ring,
 {
     schreier *sh,*sha;
     int *fixorbs;
-    int i,j,k,icell,nfails,wordlen,skips;
+    int j,k,icell,nfails,wordlen,skips;
     permnode *pn;
 #if !MAXN
     DYNALLOC1(int,workperm2,workperm2_sz,n,"expandschreier");
@@ -845,7 +1020,7 @@ getorbitsmin(int *fix, int nfix, schreier *gp, permnode **ring,
             for (j = 0; j < wordlen; ++j)
             {
                 for (skips = KRAN(17); --skips >= 0; ) pn = pn->next;
-                for (i = 0; i < n; ++i) workperm2[i] = pn->p[workperm2[i]];
+                COMPOSEPERM(workperm2,pn->p,1,n);
             }
             if (filterschreier(gp,workperm2,ring,TRUE,-1,n))
             {
@@ -957,6 +1132,7 @@ dumpschreier(FILE *f, schreier *gp, permnode *ring, int n)
 {
     schreier *sh;
     permnode *pn;
+    permblock *blk;
     int i,j,jj,k;
 
 
@@ -975,7 +1151,7 @@ dumpschreier(FILE *f, schreier *gp, permnode *ring, int n)
     fprintf(f,"gens=%d; ",j);
 
     for (j = 0, sh = schreier_freelist; sh; sh = sh->next) ++j;
-    for (k = 0, pn = permnode_freelist; pn; pn = pn->next) ++k;
+    for (k = 0, blk = permblock_avail; blk; blk = blk->next) k += blk->nfree;
     fprintf(f,"freelists: %d,%d\n",j,k);
 
     if (ring)
@@ -17,6 +17,8 @@
   Miscellaneous switches:\n\
      -p# -p#:#   Specify range of input lines (first is 1)\n\
                  May fail if input is incremental.\n\
+                 Uses the side index ifile.gidx made by labelg -p\n\
+                    if it is up to date.\n\
      -f          With -p, assume input lines of fixed length\n\
                     (only used with a file in graph6/digraph6 format)\n\
      -v          Negate all constraints (but not -p)\n\
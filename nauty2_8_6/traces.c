@@ -24,6 +24,10 @@
  *       07-Jun-18 : bug correction (finalnumcells, thanks R.Kralovic)        *
  *       07-Jun-18 : bug correction (index computation when findperm)         *
  *       10-Nov-22 : bug correction (cycles in degree 2 subgraphs)            *
+ *       19-Oct-26 : mark the refinement procedures with NAUTY_HOT            *
+ *                 : keep candidates, partitions and trie blocks in pools     *
+ *                   between calls, freed by traces_freedyn()                 *
+ *                 : initialise BigCell etc. in the refinement procedures     *
  *****************************************************************************/
 
 #include "traces.h"
@@ -75,6 +79,7 @@ typedef struct Partition {
     int active;
     int cells;
     int code;
+    struct Partition *next;   /* only used in the pools */
 } Partition;
 
 typedef struct trielist {
@@ -264,6 +269,12 @@ static struct Partition* NewPartition(int);
 static struct Candidate* NewCandidate(int, Candidate**, int);
 static void NewPartSpine(int, int);
 static int FreeList(Candidate*, int);
+static void PreparePools(int);
+static void FreePools(void);
+static struct Partition* NewPartHeader(void);
+static void ReleasePart(Partition*);
+static struct trie* NewTrieBlock(void);
+static trielist* NewSearchTrieBlock(void);
 static int FixBase(int*, struct TracesVars*, Candidate*, int, int);
 static boolean FixedBase(int*, struct TracesVars*, Candidate*, int, int);
 static void factorial(double*, int*, int);
@@ -413,11 +424,7 @@ return FALSE; \
 Ind++; }
 
 #define NEWPARTSPINE(Lev) { if (Lev > 3) { \
-Spine[Lev].part = malloc(sizeof(*(Spine[Lev].part))); \
-if (Spine[Lev].part == NULL) { \
-fprintf(ERRFILE, "\nError, memory not allocated.\n"); \
-exit(1); \
-} \
+Spine[Lev].part = NewPartHeader(); \
 Spine[Lev].part->cls = Spine[Lev-3].part->cls; \
 Spine[Lev].part->inv = Spine[Lev-3].part->inv; \
 Spine[Lev-3].part->cls = Spine[Lev-3].part->inv = NULL; \
@@ -437,16 +444,11 @@ SplCls[SplInd++] = ind1; \
 } \
 }
 
-#define FREEPART(Part) { if (Part) { \
-if (Part->cls) free(Part->cls); \
-if (Part->inv) free(Part->inv); \
-free(Part); } \
-}
+#define FREEPART(Part) { if (Part) ReleasePart(Part); }
 
 #define FREECAND(Cand) { if (Cand) { \
-if (Cand->lab) free(Cand->lab); \
-if (Cand->invlab) free(Cand->invlab); \
-free(Cand); \
+Cand->next = CandPool; \
+CandPool = Cand; \
 } }
 
 #define COPYPART(P, Q) { memcpy(P->cls, Q->cls, n*sizeof(int)); \
@@ -835,6 +837,16 @@ static TLS_ATTR trie *trieroot, *trieref;
 static TLS_ATTR int *TempOrbits = NULL;
 static TLS_ATTR sparsegraph redgraph;
 
+/* Candidates, partitions and the blocks of the tries are not freed at the
+   end of Traces() or refine_tr() but kept in these pools for the next call,
+   until traces_freedyn() is called.  Their arrays have length PoolSize. */
+static TLS_ATTR int PoolSize = 0;
+static TLS_ATTR Candidate *CandPool = NULL;
+static TLS_ATTR Partition *PartPool = NULL;     /* with cls and inv */
+static TLS_ATTR Partition *PartHdrPool = NULL;  /* without */
+static TLS_ATTR trie *TriePool = NULL;          /* linked by first_child */
+static TLS_ATTR trielist *STriePool = NULL;
+
 
 void
 Traces(sparsegraph *g_arg, int *lab, int *ptn,
@@ -862,6 +874,7 @@ Traces(sparsegraph *g_arg, int *lab, int *ptn,
     }
     
     Allocate_Traces_Structures(n);
+    PreparePools(n);
     
     struct TracesVars *tv = malloc(sizeof(struct TracesVars));
     if (tv == NULL) {
@@ -1271,9 +1284,9 @@ Traces(sparsegraph *g_arg, int *lab, int *ptn,
     
     while (STStart) {
         STAux = STStart;
-        free(STAux->triearray);
         STStart = STStart->next;
-        free(STAux);
+        STAux->next = STriePool;
+        STriePool = STAux;
     }
     
     tv->canlist = 0;
@@ -1298,7 +1311,8 @@ Traces(sparsegraph *g_arg, int *lab, int *ptn,
     
     if (!tv->options->getcanon && trieroot) {
         for (i=0; i<=tv->triepos; i++) {
-            free(TrieArray[i]);
+            TrieArray[i]->first_child = TriePool;
+            TriePool = TrieArray[i];
         }
     }
     
@@ -1314,7 +1328,6 @@ Traces(sparsegraph *g_arg, int *lab, int *ptn,
     }
     free(tv);
     free(ti);
-    traces_freedyn();
     
     return;
 }
@@ -1370,6 +1383,7 @@ int traces_vertexclass_refine (int n, int *lab, int *ptn, Candidate *Cand, Parti
     return cells;
 }
 
+NAUTY_HOT
 int traces_refine(Candidate *Cand,
                   int n,
                   Partition *Part,
@@ -1386,7 +1400,7 @@ int traces_refine(Candidate *Cand,
     int newtrace = FALSE;
     int Sparse = TRUE;
     int *lab, *cls, *InvLab, *TracePos, *SplitCell, *LabCell, *TraceEnd, Traceccend, *Tracestpend;
-    int BigCell, BigCellPos, BigCellSize;
+    int BigCell = 0, BigCellPos = 0, BigCellSize = 0;
     boolean TraceCell = FALSE;
     int *nghb;
     int conta;
@@ -2145,6 +2159,7 @@ int traces_refine(Candidate *Cand,
     }
 }
 
+NAUTY_HOT
 void traces_refine_notrace(Candidate *Cand,
                            int n,
                            Partition *Part,
@@ -2158,7 +2173,7 @@ void traces_refine_notrace(Candidate *Cand,
     int Split = 0;
     int Sparse = TRUE;
     int *lab, *cls, *InvLab, *SplitCell, *LabCell;
-    int BigCell, BigCellPos, BigCellSize;
+    int BigCell = 0, BigCellPos = 0, BigCellSize = 0;
     int *nghb;
     const int variation = 1;
     int currentweight, weightstart, weightend, currentcell, currentsize;
@@ -2741,6 +2756,7 @@ void traces_refine_notrace(Candidate *Cand,
     return;
 }
 
+NAUTY_HOT
 void traces_refine_maketrie(Candidate *Cand,
                             int n,
                             Partition *Part,
@@ -2754,7 +2770,7 @@ void traces_refine_maketrie(Candidate *Cand,
     int Split = 0;
     int Sparse = TRUE;
     int *lab, *cls, *InvLab, *SplitCell, *LabCell;
-    int BigCell, BigCellPos, BigCellSize;
+    int BigCell = 0, BigCellPos = 0, BigCellSize = 0;
     int *nghb;
     const int variation = 1;
     int currentweight, weightstart, weightend, currentcell, currentsize;
@@ -3318,6 +3334,7 @@ void traces_refine_maketrie(Candidate *Cand,
     return;
 }
 
+NAUTY_HOT
 int traces_refine_comptrie(Candidate *Cand,
                            int n,
                            Partition *Part,
@@ -3331,7 +3348,7 @@ int traces_refine_comptrie(Candidate *Cand,
     int Split = 0;
     int Sparse = TRUE;
     int *lab, *cls, *InvLab, *SplitCell, *LabCell;
-    int BigCell, BigCellPos, BigCellSize;
+    int BigCell = 0, BigCellPos = 0, BigCellSize = 0;
     int *nghb;
     const int variation = 1;
     int currentweight, weightstart, weightend, currentcell, currentsize;
@@ -3901,6 +3918,7 @@ int traces_refine_comptrie(Candidate *Cand,
     return 1;
 }
 
+NAUTY_HOT
 int traces_refine_sametrace(Candidate *Cand,
                             int n,
                             Partition *Part,
@@ -3913,7 +3931,7 @@ int traces_refine_sametrace(Candidate *Cand,
     unsigned int longcode;
     int Sparse = TRUE;
     int *lab, *cls, *InvLab, *TracePos, *SplitCell, *LabCell, *TraceEnd, Traceccend, *Tracestpend;
-    int BigCell, BigCellPos, BigCellSize;
+    int BigCell = 0, BigCellPos = 0, BigCellSize = 0;
     boolean TraceCell = FALSE;
     int *nghb;
     const int variation = 0;
@@ -4598,6 +4616,7 @@ void refine_tr(sparsegraph *sg, int *lab, int *ptn, int *numcells, int *code, Tr
     }
     
     Allocate_refine_Structures(n);
+    PreparePools(n);
     
     tv = &tvar;
     ti = &tinf;
@@ -4741,6 +4760,7 @@ void refine_tr(sparsegraph *sg, int *lab, int *ptn, int *numcells, int *code, Tr
 #endif
 }
 
+NAUTY_HOT
 void refine_tr_refine(Candidate *Cand,
                       int n,
                       Partition *Part,
@@ -4755,7 +4775,7 @@ void refine_tr_refine(Candidate *Cand,
     int newtrace = FALSE;
     int Sparse = TRUE;
     int *lab, *cls, *InvLab, *TracePos, *SplitCell, *LabCell, TraceEnd, Traceccend, Tracestpend;
-    int BigCell, BigCellPos, BigCellSize;
+    int BigCell = 0, BigCellPos = 0, BigCellSize = 0;
     boolean TraceCell = FALSE;
     int *nghb;
     const int variation = 0;
@@ -5481,18 +5501,22 @@ struct Candidate *NewCandidate(int n, Candidate **GarbList, int Mrk) {
         Cand = *GarbList;
         *GarbList = (*GarbList)->next;
     }
+    else if (CandPool) {
+        Cand = CandPool;
+        CandPool = CandPool->next;
+    }
     else {
         Cand = malloc(sizeof(*Cand));
         if (Cand == NULL) {
             fprintf(ERRFILE, "\nError, memory not allocated.\n");
             exit(1);
         }
-        Cand->lab = malloc(n*sizeof(*Cand->lab));
+        Cand->lab = malloc(PoolSize*sizeof(*Cand->lab));
         if (Cand->lab == NULL) {
             fprintf(ERRFILE, "\nError, memory not allocated.\n");
             exit(1);
         }
-        Cand->invlab = malloc(n*sizeof(*Cand->invlab));
+        Cand->invlab = malloc(PoolSize*sizeof(*Cand->invlab));
         if (Cand->invlab == NULL) {
             fprintf(ERRFILE, "\nError, memory not allocated.\n");
             exit(1);
@@ -7819,16 +7843,16 @@ int FreeList(Candidate *List, int cond) {
     int conta = 0;
     int conta1 = 0;
     
+    /* The candidates go back to CandPool */
     while (List) {
         if (List->do_it == cond) {
             conta1++;
         }
         conta++;
         Temp = List;
-        if (List->lab) free(List->lab);
-        if (List->invlab) free(List->invlab);
         List = List->next;
-        free(Temp);
+        Temp->next = CandPool;
+        CandPool = Temp;
     }
     
     if (cond) {
@@ -8978,34 +9002,74 @@ void orbjoin_sp_perm(int *orbits, int *map, int *list, int n, int *numorbs) {
 struct Partition *NewPartition(int n) {
     struct Partition *P;
     
-    P = malloc(sizeof(*(P)));
-    if (P == NULL) {
-        fprintf(ERRFILE, "\nError, memory not allocated.\n");
-        exit(1);
+    if (PartPool) {
+        P = PartPool;
+        PartPool = PartPool->next;
     }
-    P->cls = malloc(n*sizeof(int));
-    if (P->cls == NULL) {
-        fprintf(ERRFILE, "\nError, memory not allocated.\n");
-        exit(1);
-    }
-    P->inv = malloc(n*sizeof(int));
-    if (P->inv == NULL) {
-        fprintf(ERRFILE, "\nError, memory not allocated.\n");
-        exit(1);
+    else {
+        P = NewPartHeader();
+        P->cls = malloc(PoolSize*sizeof(int));
+        if (P->cls == NULL) {
+            fprintf(ERRFILE, "\nError, memory not allocated.\n");
+            exit(1);
+        }
+        P->inv = malloc(PoolSize*sizeof(int));
+        if (P->inv == NULL) {
+            fprintf(ERRFILE, "\nError, memory not allocated.\n");
+            exit(1);
+        }
     }
     P->code = -1;
     P->cells = 0;
     return P;
 }
 
-void NewPartSpine(int Lev, int n) {
+/*****************************************************************************
+ *                                                                            *
+ *  NewPartHeader() returns a Partition without cls and inv arrays, as used   *
+ *  by NewPartSpine() for levels whose arrays are taken from three levels up. *
+ *  ReleasePart(P) puts P into PartPool, or into PartHdrPool if it has lost   *
+ *  its arrays.                                                               *
+ *                                                                            *
+ *****************************************************************************/
+
+struct Partition *NewPartHeader(void) {
+    struct Partition *P;
     
-    if (Lev > 3) {
-        Spine[Lev].part = malloc(sizeof(*(Spine[Lev].part)));
-        if (Spine[Lev].part == NULL) {
+    if (PartHdrPool) {
+        P = PartHdrPool;
+        PartHdrPool = PartHdrPool->next;
+    }
+    else {
+        P = malloc(sizeof(*(P)));
+        if (P == NULL) {
             fprintf(ERRFILE, "\nError, memory not allocated.\n");
             exit(1);
         }
+    }
+    P->cls = P->inv = NULL;
+    return P;
+}
+
+void ReleasePart(Partition *P) {
+    
+    if (P->cls && P->inv) {
+        P->next = PartPool;
+        PartPool = P;
+    }
+    else {
+        if (P->cls) free(P->cls);
+        if (P->inv) free(P->inv);
+        P->cls = P->inv = NULL;
+        P->next = PartHdrPool;
+        PartHdrPool = P;
+    }
+}
+
+void NewPartSpine(int Lev, int n) {
+    
+    if (Lev > 3) {
+        Spine[Lev].part = NewPartHeader();
         Spine[Lev].part->cls = Spine[Lev-3].part->cls;
         Spine[Lev].part->inv = Spine[Lev-3].part->inv;
         Spine[Lev-3].part->cls = Spine[Lev-3].part->inv = NULL;
@@ -9481,19 +9545,10 @@ searchtrie *searchtrie_make(Candidate *CurrCand, Candidate *NextCand, int n, str
     searchtrie *st;
     if (tv->strienext == n) {
         tv->strienext = 0;
-        tv->strielist->next = malloc(sizeof(struct trielist));
-        if (tv->strielist->next == NULL) {
-            fprintf(ERRFILE, "\nError, memory not allocated.\n");
-            exit(1);
-        }
+        tv->strielist->next = NewSearchTrieBlock();
         tv->strielist->next->prev = tv->strielist;
         tv->strielist = tv->strielist->next;
         tv->strielist->next = NULL;
-        tv->strielist->triearray = malloc(n*sizeof(searchtrie));
-        if (tv->strielist->triearray == NULL) {
-            fprintf(ERRFILE, "\nError, memory not allocated.\n");
-            exit(1);
-        }
     }
     st = &(tv->strielist->triearray[tv->strienext]);
     st->father = CurrCand->stnode;
@@ -9525,17 +9580,8 @@ searchtrie *searchtrie_make(Candidate *CurrCand, Candidate *NextCand, int n, str
 
 trielist *searchtrie_new(int n, struct TracesVars *tv) {
     
-    tv->strielist = malloc(sizeof(struct trielist));
-    if (tv->strielist == NULL) {
-        fprintf(ERRFILE, "\nError, memory not allocated.\n");
-        exit(1);
-    }
+    tv->strielist = NewSearchTrieBlock();
     tv->strielist->prev = tv->strielist->next = NULL;
-    tv->strielist->triearray = malloc(n*sizeof(searchtrie));
-    if (tv->strielist->triearray == NULL) {
-        fprintf(ERRFILE, "\nError, memory not allocated.\n");
-        exit(1);
-    }
     tv->strielist->triearray[0].father = tv->strielist->triearray[0].first_child = NULL;
     tv->strielist->triearray[0].next_sibling = tv->strielist->triearray[0].last_child = NULL;
     tv->strielist->triearray[0].goes_to = NULL;
@@ -9912,6 +9958,7 @@ boolean TargetCellFirstPath(Candidate *TargCand, Partition *Part, struct TracesV
 
 void traces_freedyn(void) {
     /* Free the static dynamic memory used by Traces */
+    FreePools();
 #if !MAXN
     DYNFREE(AUTPERM, AUTPERM_sz);
     DYNFREE(BreakSteps, BreakSteps_sz);
@@ -10077,7 +10124,8 @@ int trie_classify(int n, TracesVars *tv) {
     trie_class(trieroot,&ord);
     
     for (i=0; i<=tv->triepos; i++) {
-        free(TrieArray[i]);
+        TrieArray[i]->first_child = TriePool;
+        TriePool = TrieArray[i];
     }
     trieroot = NULL;
     return ord-1;
@@ -10129,11 +10177,7 @@ struct trie *trie_make(trie *t, int value, int n, struct TracesVars* tv) {
     if (tv->trienext == n) {
         tv->trienext = 0;
         tv->triepos++;
-        TrieArray[tv->triepos] = malloc(n*sizeof(trie));
-        if (TrieArray[tv->triepos] == NULL) {
-            fprintf(ERRFILE, "\nError, memory not allocated.\n");
-            exit(1);
-        }
+        TrieArray[tv->triepos] = NewTrieBlock();
     }
     if (t->first_child) {
         t = t->first_child;
@@ -10173,17 +10217,108 @@ struct trie *trie_make(trie *t, int value, int n, struct TracesVars* tv) {
 
 struct trie *trie_new(int n, struct TracesVars* tv) {
     
-    TrieArray[0] = malloc(n*sizeof(trie));
-    if (TrieArray[0] == NULL) {
-        fprintf(ERRFILE, "\nError, memory not allocated.\n");
-        exit(1);
-    }
+    TrieArray[0] = NewTrieBlock();
     TrieArray[0][0].first_child = TrieArray[0][0].next_sibling = NULL;
     tv->triepos = 0;
     tv->trienext = 1;
     return TrieArray[0];
 }
 
+/*****************************************************************************
+ *                                                                            *
+ *  PreparePools(n) makes the pools usable for graphs with n vertices; they   *
+ *  are emptied if their arrays are shorter than n.  FreePools() frees all    *
+ *  that they contain.  NewTrieBlock() and NewSearchTrieBlock() return a      *
+ *  block of PoolSize trie or searchtrie nodes, from the pool if possible.    *
+ *                                                                            *
+ *****************************************************************************/
+
+void PreparePools(int n) {
+    
+    if (n > PoolSize) {
+        FreePools();
+        PoolSize = n;
+    }
+}
+
+void FreePools(void) {
+    Candidate *Cand;
+    Partition *P;
+    trie *T;
+    trielist *TL;
+    
+    while (CandPool) {
+        Cand = CandPool;
+        CandPool = CandPool->next;
+        free(Cand->lab);
+        free(Cand->invlab);
+        free(Cand);
+    }
+    while (PartPool) {
+        P = PartPool;
+        PartPool = PartPool->next;
+        free(P->cls);
+        free(P->inv);
+        free(P);
+    }
+    while (PartHdrPool) {
+        P = PartHdrPool;
+        PartHdrPool = PartHdrPool->next;
+        free(P);
+    }
+    while (TriePool) {
+        T = TriePool;
+        TriePool = TriePool->first_child;
+        free(T);
+    }
+    while (STriePool) {
+        TL = STriePool;
+        STriePool = STriePool->next;
+        free(TL->triearray);
+        free(TL);
+    }
+    PoolSize = 0;
+}
+
+struct trie *NewTrieBlock(void) {
+    trie *T;
+    
+    if (TriePool) {
+        T = TriePool;
+        TriePool = TriePool->first_child;
+    }
+    else {
+        T = malloc(PoolSize*sizeof(trie));
+        if (T == NULL) {
+            fprintf(ERRFILE, "\nError, memory not allocated.\n");
+            exit(1);
+        }
+    }
+    return T;
+}
+
+trielist *NewSearchTrieBlock(void) {
+    trielist *TL;
+    
+    if (STriePool) {
+        TL = STriePool;
+        STriePool = STriePool->next;
+    }
+    else {
+        TL = malloc(sizeof(struct trielist));
+        if (TL == NULL) {
+            fprintf(ERRFILE, "\nError, memory not allocated.\n");
+            exit(1);
+        }
+        TL->triearray = malloc(PoolSize*sizeof(searchtrie));
+        if (TL->triearray == NULL) {
+            fprintf(ERRFILE, "\nError, memory not allocated.\n");
+            exit(1);
+        }
+    }
+    return TL;
+}
+
 boolean VerifyCand(Candidate *Cand, int n, int line) {
     int i, k;
     
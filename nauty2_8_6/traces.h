@@ -26,6 +26,9 @@
  *       10-Nov-22 : bug correction (cycles in degree 2 subgraphs)            *
 ******************************************************************************/
 
+#ifndef  _TRACES_H_    /* only process this file once */
+#define  _TRACES_H_
+
 #include "gtools.h"
 #include "schreier.h" 
 
@@ -71,3 +74,5 @@ extern void traces_freedyn(void);
 #ifdef __cplusplus
 }
 #endif
+
+#endif  /* _TRACES_H_ */
@@ -30,6 +30,14 @@ gap> Diameter(P);
 2
 gap> Girth(P);
 5
+gap> P = Graph( SymmetricGroup(5), [[1,2]], OnSets,
+>    function(x,Y) return List(Y,y->Intersection(x,y)=[]); end : relbatch );
+true
+gap> H:=HammingGraph(3,3);;
+gap> GlobalParameters(H);
+[ [ 0, 0, 6 ], [ 1, 1, 4 ], [ 2, 2, 2 ], [ 3, 3, 0 ] ]
+gap> Size(H.group);
+1296
 gap> EP := EdgeGraph(P);;
 gap> GlobalParameters(EP);
 [ [ 0, 0, 4 ], [ 1, 1, 2 ], [ 1, 2, 1 ], [ 4, 0, 0 ] ]
@@ -40,6 +48,11 @@ gap> Girth(C);
 4
 gap> Diameter(C);
 6
+gap> D:=CayleyGraph(SymmetricGroup(4),[(1,2,3,4)],false);;
+gap> IsSimpleGraph(D);
+false
+gap> Adjacency(UnderlyingGraph(D),1)=Adjacency(CayleyGraph(SymmetricGroup(4),[(1,2,3,4)]),1);
+true
 gap> gamma := NullGraph( Group( (1,3), (1,2)(3,4) ) );;
 gap> AddEdgeOrbit( gamma, [4,3] );
 gap> GlobalParameters(gamma);
@@ -173,6 +186,16 @@ gap> OrbitalDigraphColadjMats(C);
       [ 0, 1, 0, 0, 0 ], [ 0, 0, 1, 0, 0 ] ], 
   [ [ 0, 0, 0, 0, 1 ], [ 1, 0, 0, 0, 0 ], [ 0, 1, 0, 0, 0 ], 
       [ 0, 0, 1, 0, 0 ], [ 0, 0, 0, 1, 0 ] ] ]
+gap> G:=Action(SymmetricGroup(8),Combinations([1..8],4),OnSets);;
+gap> v:=VertexTransitiveDRGs(G : statistics);;
+gap> v.orbitalCombinations;
+[ [ 2 ], [ 2, 3, 4 ], [ 2, 3, 4, 5 ] ]
+gap> v.statistics.nodes;
+[ 4, 6, 3, 1 ]
+gap> v.statistics.pruned;
+[ 0, 1, 0, 0 ]
+gap> IsBound(VertexTransitiveDRGs(G).statistics);
+false
 gap> ConnectedComponent( NullGraph( Group((1,2)) ), 2 );
 [ 2 ]
 gap> ConnectedComponent( JohnsonGraph(4,2), 2 );
@@ -239,6 +262,10 @@ gap> IsIsomorphicGraph( gamma, delta );
 true
 gap> Length(Set(VertexColouring( JohnsonGraph(4,2) )));
 3
+gap> IsVertexColouring(JohnsonGraph(5,2),GRAPE_DSaturColouring(JohnsonGraph(5,2)),5);
+true
+gap> GRAPE_DSaturColouring(JohnsonGraph(5,2),4);
+fail
 gap> gamma := JohnsonGraph(5,2);;
 gap> Length(CompleteSubgraphs(gamma,3,2));
 2
@@ -279,6 +306,32 @@ gap> CompleteSubgraphsOfGivenSize(delta,5,1,false,true,
 >    [1,2,3,4,5,6,7,8,7,6,5,4,3,2,1]);
 [ [ 1, 4 ], [ 2, 3 ], [ 3, 14 ], [ 4, 15 ], [ 5 ], [ 11 ], [ 12, 15 ], 
   [ 13, 14 ] ]
+gap> GRAPE_CHECKPOINT_FILE:=Filename(DirectoryTemporary(),"grape.chk");;
+gap> GRAPE_CHECKPOINT_INTERVAL:=0;;
+gap> CompleteSubgraphsOfGivenSize(delta,5,2,true);
+[ [ 1, 2, 3, 4, 5 ], [ 1, 6, 7, 8, 9 ], [ 2, 6, 10, 11, 12 ],
+  [ 3, 7, 10, 13, 14 ], [ 4, 8, 11, 13, 15 ], [ 5, 9, 12, 14, 15 ] ]
+gap> List(CompleteSubgraphs(JohnsonGraph(7,2),-1,2),Length);
+[ 6, 3 ]
+gap> IsExistingFile(GRAPE_CHECKPOINT_FILE);
+false
+gap> gamma:=NewGroupGraph(Group(()),JohnsonGraph(5,2));;
+gap> GRAPE_CHECKPOINT_FILE:=fail;;
+gap> K:=CompleteSubgraphs(gamma,-1,1);;
+gap> Length(K);
+15
+gap> GRAPE_CHECKPOINT_FILE:=Filename(DirectoryTemporary(),"grape.chk");;
+gap> PrintTo(GRAPE_CHECKPOINT_FILE,"return ",rec(
+>      key:=["CompleteSubgraphsMain",gamma.order,GeneratorsOfGroup(gamma.group),
+>            gamma.representatives,gamma.adjacencies,[-1],1,true,false,
+>            List([1..gamma.order],x->[1]),[1]],
+>      forbidden:=[1],ans:=Filtered(K,x->1 in x)),";\n");
+gap> CompleteSubgraphs(gamma,-1,1)=K;
+true
+gap> IsExistingFile(GRAPE_CHECKPOINT_FILE);
+false
+gap> GRAPE_CHECKPOINT_FILE:=fail;;
+gap> GRAPE_CHECKPOINT_INTERVAL:=600;;
 gap> IsIsomorphicGraph(JohnsonGraph(7,3),JohnsonGraph(7,4));
 true
 gap> gamma:=JohnsonGraph(4,2);;
@@ -344,6 +397,11 @@ gap> List(L,VertexDegrees);
 [ [ 12 ], [ 30 ], [ 34 ], [ 16 ], [ 18 ], [ 22 ], [ 4 ] ]
 gap> List(L,Diameter);
 [ 3, 2, 1, 2, 2, 2, 3 ]
+gap> iter:=IteratorOfGeneralizedOrbitalGraphs(G,false,x->Diameter(x)=2);;
+gap> D:=[];; for gamma in iter do Add(D,VertexDegrees(gamma)); od; Set(D);
+[ [ 16 ], [ 18 ], [ 22 ], [ 30 ] ]
+gap> D:=[];; for gamma in IteratorOfGeneralizedOrbitalGraphs(G,2) do Add(D,VertexDegrees(gamma)); od; Set(D);
+[ [ 16 ], [ 22 ], [ 30 ] ]
 gap> C:=CyclicGroup(IsPermGroup,6);
 Group([ (1,2,3,4,5,6) ])
 gap> GeneralizedOrbitalGraphs(C,1);
@@ -487,6 +545,10 @@ fail
 gap> G:=PGL(2,5);;
 gap> GRAPE_ExactSetCover(G,[[1,2,3]],6);
 [ [ 1, 2, 3 ], [ 4, 5, 6 ] ]
+gap> GRAPE_ExactSetCover(G,[[1,2,3]],6,Group(()),"count");
+10
+gap> Length(GRAPE_ExactSetCover(G,[[1,2,3]],6,Group(()),"all"));
+10
 gap> n:=280;;
 gap> G:=OnePrimitiveGroup(NrMovedPoints,n,Size,604800*2);
 J_2.2